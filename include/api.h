@@ -23,16 +23,36 @@ namespace db_api {
 
 const std::string kRouteInsert = "/insert";
 const std::string kRouteUpdate = "/update";
+const std::string kRoutePatch = "/patch";
 const std::string kRouteErase = "/erase";
 const std::string kRouteFind = "/find";
 
 const std::string kServiceDatabase = "db";
 const std::string kServiceUser = "user";
 
+class InsertStream : public HttpStream {
+ public:
+  InsertStream(DocumentDatabase *database);
+  virtual ~InsertStream();
+  virtual void Consume(const std::string &chunk);
+  virtual HttpResponse Finish();
+
+ private:
+  void Abort();
+  DocumentDatabase *database_;
+  JsonStreamParser parser_;
+  JsonArray result_;
+  bool failed_;
+  bool finished_;
+};
+
 HttpResponse Insert(const HttpRequest &request, ServiceMap &services);
 HttpResponse Update(const HttpRequest &request, ServiceMap &services);
+HttpResponse Patch(const HttpRequest &request, ServiceMap &services);
 HttpResponse Erase(const HttpRequest &request, ServiceMap &services);
 HttpResponse Find(const HttpRequest &request, ServiceMap &services);
+std::unique_ptr<HttpStream> StreamInsert(const HttpRequest &request,
+                                         ServiceMap &services);
 
 }  // namespace db_api
 
@@ -0,0 +1,138 @@
+/* Copyright 2022 Jonas Hegemann <jonas.hegemann@hotmail.de>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <list>
+#include <unordered_map>
+
+#include "map.h"
+
+template <class K, class V>
+class Cache {
+ public:
+  Cache(uint64_t capacity = 0);
+  virtual ~Cache();
+  bool IsEnabled() const;
+  uint64_t GetCapacity() const;
+  void SetCapacity(uint64_t capacity);
+  uint64_t GetConsumption() const;
+  size_t Size() const;
+  const V *Find(const K &key);
+  void Insert(const K &key, const V &value);
+  bool Erase(const K &key);
+  void Clear();
+
+ private:
+  typedef std::list<std::pair<K, V>> Entries;
+  uint64_t Consumption(const K &key, const V &value) const;
+  void Trim();
+  Entries entries_;
+  std::unordered_map<K, typename Entries::iterator> index_;
+  uint64_t capacity_;
+  uint64_t consumption_;
+};
+
+template <class K, class V>
+Cache<K, V>::Cache(uint64_t capacity) : capacity_(capacity), consumption_(0) {}
+
+template <class K, class V>
+Cache<K, V>::~Cache() {}
+
+template <class K, class V>
+inline bool Cache<K, V>::IsEnabled() const {
+  return capacity_ > 0;
+}
+
+template <class K, class V>
+inline uint64_t Cache<K, V>::GetCapacity() const {
+  return capacity_;
+}
+
+template <class K, class V>
+void Cache<K, V>::SetCapacity(uint64_t capacity) {
+  capacity_ = capacity;
+  Trim();
+}
+
+template <class K, class V>
+inline uint64_t Cache<K, V>::GetConsumption() const {
+  return consumption_;
+}
+
+template <class K, class V>
+inline size_t Cache<K, V>::Size() const {
+  return index_.size();
+}
+
+template <class K, class V>
+const V *Cache<K, V>::Find(const K &key) {
+  auto lookup = index_.find(key);
+  if (lookup == index_.end()) {
+    return nullptr;
+  }
+  entries_.splice(entries_.begin(), entries_, lookup->second);
+  return &lookup->second->second;
+}
+
+template <class K, class V>
+void Cache<K, V>::Insert(const K &key, const V &value) {
+  if (!IsEnabled()) {
+    return;
+  }
+  Erase(key);
+  const uint64_t consumption = Consumption(key, value);
+  if (consumption > capacity_) {
+    return;
+  }
+  entries_.emplace_front(key, value);
+  index_.insert(std::make_pair(key, entries_.begin()));
+  consumption_ += consumption;
+  Trim();
+}
+
+template <class K, class V>
+bool Cache<K, V>::Erase(const K &key) {
+  auto lookup = index_.find(key);
+  if (lookup == index_.end()) {
+    return false;
+  }
+  consumption_ -= Consumption(lookup->second->first, lookup->second->second);
+  entries_.erase(lookup->second);
+  index_.erase(lookup);
+  return true;
+}
+
+template <class K, class V>
+void Cache<K, V>::Clear() {
+  entries_.clear();
+  index_.clear();
+  consumption_ = 0;
+}
+
+template <class K, class V>
+inline uint64_t Cache<K, V>::Consumption(const K &key, const V &value) const {
+  return 2 * Memory<K>::Consumption(key) + Memory<V>::Consumption(value) +
+         4 * sizeof(void *);
+}
+
+template <class K, class V>
+void Cache<K, V>::Trim() {
+  while (consumption_ > capacity_ && !entries_.empty()) {
+    Erase(entries_.back().first);
+  }
+}
+
+#endif
\ No newline at end of file
@@ -30,6 +30,7 @@ class Client {
   virtual ~Client();
   JsonArray Insert(const JsonArray &values);
   JsonObject Update(const JsonObject &values);
+  JsonObject Patch(const JsonObject &patches);
   JsonArray Erase(const JsonArray &keys);
   JsonArray Find(const JsonArray &keys);
 
@@ -0,0 +1,43 @@
+/* Copyright 2022 Jonas Hegemann <jonas.hegemann@hotmail.de>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <cstdint>
+#include <string>
+
+#include "encoding.h"
+
+const std::string kCompressionNone = "none";
+const std::string kCompressionLz = "lz";
+const size_t kCompressionHashBits = 12;
+const size_t kCompressionMinimumMatch = 4;
+const size_t kCompressionMaximumOffset = 65535;
+const size_t kCompressionEndLiterals = 5;
+const uint64_t kCompressionExpansionMaximum = 255;
+const uint64_t kCompressionBlockMaximum = 1ull << 31;
+
+enum CompressionCodec { COMPRESSION_NONE = 0, COMPRESSION_LZ };
+
+namespace compression {
+
+void Compress(CompressionCodec codec, const char *data, size_t length,
+              std::string &output);
+bool Decompress(CompressionCodec codec, const char *data, size_t length,
+                std::string &output, size_t limit);
+
+}  // namespace compression
+
+#endif
\ No newline at end of file
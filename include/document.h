@@ -0,0 +1,84 @@
+/* Copyright 2022 Jonas Hegemann <jonas.hegemann@hotmail.de>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#ifndef DOCUMENT_H
+#define DOCUMENT_H
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "json.h"
+#include "utils.h"
+
+class BinaryDocument;
+
+typedef uint32_t BinaryOffset;
+
+const size_t kBinaryHeaderSize = sizeof(uint8_t) + 2 * sizeof(BinaryOffset);
+
+class BinaryDocument {
+ public:
+  BinaryDocument();
+  BinaryDocument(const BinaryDocument &document);
+  BinaryDocument(const std::string &source);
+  BinaryDocument(const JsonObject &object);
+  virtual ~BinaryDocument();
+  bool operator==(const BinaryDocument &other) const;
+  bool operator!=(const BinaryDocument &other) const;
+  bool IsEmpty() const;
+  uint8_t GetType() const;
+  size_t Size() const;
+  bool Has(const std::string &key) const;
+  std::vector<std::string> Keys() const;
+  bool IsNull(const std::string &key) const;
+  bool IsBoolean(const std::string &key) const;
+  bool IsInteger(const std::string &key) const;
+  bool IsFloat(const std::string &key) const;
+  bool IsString(const std::string &key) const;
+  bool IsObject(const std::string &key) const;
+  bool IsArray(const std::string &key) const;
+  JsonBoolean GetBoolean(const std::string &key) const;
+  JsonInteger GetInteger(const std::string &key) const;
+  JsonFloat GetFloat(const std::string &key) const;
+  JsonString GetString(const std::string &key) const;
+  BinaryDocument GetDocument(const std::string &key) const;
+  BinaryDocument GetDocument(size_t index) const;
+  JsonObject ToObject() const;
+  JsonArray ToArray() const;
+  const std::string &GetBytes() const;
+  void SetBytes(const std::string &bytes);
+  void Clear();
+  std::string String() const;
+  void Parse(const std::string &source);
+
+ private:
+  std::string bytes_;
+  size_t Locate(const std::string &key) const;
+  uint8_t TypeAt(const std::string &key) const;
+};
+
+namespace document {
+
+size_t Serialize(const BinaryDocument &document, std::ostream &stream);
+size_t Deserialize(BinaryDocument &document, std::istream &stream);
+size_t Deserialize(BinaryDocument &document, EncodingReader &reader);
+
+uint64_t Memory(const BinaryDocument &document);
+
+}  // namespace document
+
+#endif
\ No newline at end of file
@@ -0,0 +1,126 @@
+/* Copyright 2022 Jonas Hegemann <jonas.hegemann@hotmail.de>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#ifndef ENCODING_H
+#define ENCODING_H
+
+#include <sys/mman.h>
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "utils.h"
+
+const std::string kEncodingMagic = "MUON";
+const uint8_t kEncodingVersionLegacy = 1;
+const uint8_t kEncodingVersion2 = 2;
+const uint8_t kEncodingFlagDictionary = 1;
+const uint8_t kEncodingFlagFramed = 2;
+const uint8_t kEncodingFlagPaged = 4;
+const uint8_t kEncodingFlagCompressed = 8;
+const size_t kEncodingHeaderSize = 6;
+const size_t kEncodingDictionaryMaximum = 65536;
+const size_t kEncodingVarintMaximum = 10;
+const uint32_t kEncodingCrc32cPolynomial = 0x82f63b78;
+
+class EncodingDictionary {
+ public:
+  EncodingDictionary();
+  virtual ~EncodingDictionary();
+  size_t Find(const std::string &key) const;
+  const std::string &Get(size_t index) const;
+  bool Add(const std::string &key);
+  size_t Size() const;
+  void Clear();
+
+ private:
+  std::unordered_map<std::string, size_t> index_;
+  std::vector<std::string> keys_;
+};
+
+class EncodingReader {
+ public:
+  EncodingReader(const char *data, size_t size);
+  virtual ~EncodingReader();
+  explicit operator bool() const;
+  const char *Take(size_t length);
+  const char *Current() const;
+  size_t Offset() const;
+  size_t Size() const;
+  size_t Remaining() const;
+  void SetVersion(uint8_t version);
+  uint8_t GetVersion() const;
+  void SetDictionary(EncodingDictionary *dictionary);
+  EncodingDictionary *GetDictionary() const;
+
+ private:
+  const char *data_;
+  size_t size_;
+  size_t offset_;
+  bool good_;
+  uint8_t version_;
+  EncodingDictionary *dictionary_;
+};
+
+class MappedFile {
+ public:
+  MappedFile();
+  virtual ~MappedFile();
+  bool Open(const std::string &filepath, int advice = MADV_SEQUENTIAL);
+  void Close();
+  const char *GetData() const;
+  size_t Size() const;
+
+ private:
+  int descriptor_;
+  void *data_;
+  size_t size_;
+};
+
+namespace encoding {
+
+void SetVersion(std::ios_base &stream, uint8_t version);
+uint8_t GetVersion(std::ios_base &stream);
+bool IsLegacy(std::ios_base &stream);
+void SetDictionary(std::ios_base &stream, EncodingDictionary *dictionary);
+EncodingDictionary *GetDictionary(std::ios_base &stream);
+size_t WriteHeader(std::ostream &stream, uint8_t flags = 0, uint8_t codec = 0);
+size_t ReadHeader(std::istream &stream, uint8_t &flags);
+size_t WriteVarint(std::ostream &stream, uint64_t value);
+size_t ReadVarint(std::istream &stream, uint64_t &value);
+uint64_t ZigZagEncode(int64_t value);
+int64_t ZigZagDecode(uint64_t value);
+size_t WriteLength(std::ostream &stream, size_t length);
+size_t ReadLength(std::istream &stream, size_t &length);
+size_t WriteString(std::ostream &stream, const std::string &value);
+size_t ReadString(std::istream &stream, std::string &value);
+size_t WriteKey(std::ostream &stream, const std::string &key);
+size_t ReadKey(std::istream &stream, std::string &key);
+bool IsLegacy(const EncodingReader &reader);
+size_t ReadHeader(EncodingReader &reader, uint8_t &flags);
+size_t ReadHeader(EncodingReader &reader, uint8_t &flags, uint8_t &codec);
+size_t ReadBytes(std::istream &stream, void *destination, size_t length);
+size_t ReadBytes(EncodingReader &reader, void *destination, size_t length);
+size_t ReadVarint(EncodingReader &reader, uint64_t &value);
+size_t ReadLength(EncodingReader &reader, size_t &length);
+size_t ReadString(EncodingReader &reader, std::string &value);
+size_t ReadKey(EncodingReader &reader, std::string &key);
+uint32_t Crc32c(const char *data, size_t length, uint32_t crc = 0);
+
+}  // namespace encoding
+
+#endif
\ No newline at end of file
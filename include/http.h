@@ -16,13 +16,16 @@ limitations under the License. */
 #define HTTP_H
 
 #include <signal.h>
+#include <sys/eventfd.h>
 #include <sys/signalfd.h>
 #include <sys/timerfd.h>
 
+#include <algorithm>
 #include <atomic>
 #include <deque>
 #include <functional>
 #include <map>
+#include <memory_resource>
 #include <mutex>
 #include <optional>
 #include <sstream>
@@ -37,6 +40,7 @@ limitations under the License. */
 class HttpPacket;
 class HttpRequest;
 class HttpResponse;
+class HttpStream;
 class HttpConnection;
 class HttpServer;
 
@@ -46,6 +50,7 @@ const std::string kHttpDoubleLineFeed = "\r\n\r\n";
 const long kHttpConnectionTimeout = 10000;
 const long kHttpMaxHeaderCount = 128;
 const unsigned int kHttpReservedSockets = 3;
+const size_t kHttpArenaSize = 65536;
 
 const std::string kHttpAuthorization = "authorization";
 const std::string kHttpBasic = "Basic";
@@ -152,6 +157,8 @@ class HttpRequest : public HttpPacket {
   const std::string &GetUrl() const;
   void SetProtocol(const std::string &protocol);
   const std::string &GetProtocol() const;
+  void SetArena(std::pmr::memory_resource *arena);
+  std::pmr::memory_resource *GetArena() const;
   const std::string String() const;
   const std::string AsShortString() const;
 
@@ -159,6 +166,7 @@ class HttpRequest : public HttpPacket {
   HttpMethod method_;
   std::string url_;
   std::string protocol_;
+  std::pmr::memory_resource *arena_;
 };
 
 class HttpResponse : public HttpPacket {
@@ -185,6 +193,17 @@ class HttpResponse : public HttpPacket {
   std::string message_;
 };
 
+class HttpStream {
+ public:
+  HttpStream();
+  virtual ~HttpStream();
+  virtual void Consume(const std::string &chunk) = 0;
+  virtual HttpResponse Finish() = 0;
+};
+
+typedef std::function<std::unique_ptr<HttpStream>(const HttpRequest &)>
+    HttpStreamOpener;
+
 enum HttpStage {
   START = 0,
   METHOD,
@@ -207,6 +226,8 @@ class HttpConnection {
   TcpWriter *GetWriter() const;
   const HttpRequest &GetRequest() const;
   const HttpResponse &GetResponse() const;
+  HttpStream *GetStream() const;
+  void SetStreamOpener(HttpStreamOpener opener);
   void ParseRequest();
   void ParseResponse();
   void Restart();
@@ -215,22 +236,31 @@ class HttpConnection {
   long GetExpiry() const;
 
  private:
-  void ParseMessage(HttpPacket &packet);
+  void ParseHeaders(HttpPacket &packet);
+  void ParseBody(HttpPacket &packet);
+  std::vector<char> arena_buffer_;
+  std::pmr::monotonic_buffer_resource arena_;
   HttpRequest request_;
   HttpResponse response_;
   HttpStage stage_;
   HttpMethod method_;
   size_t count_headers_;
+  size_t body_length_;
   HttpStatus status_;
   TcpReader *reader_;
   TcpWriter *writer_;
   TcpSocket *socket_;
   long expiry_;
+  HttpStreamOpener opener_;
+  std::unique_ptr<HttpStream> stream_;
 };
 
 typedef std::map<std::string, ApiService *> ServiceMap;
 typedef std::function<HttpResponse(const HttpRequest &, ServiceMap &services)>
     HttpCallback;
+typedef std::function<std::unique_ptr<HttpStream>(const HttpRequest &,
+                                                  ServiceMap &services)>
+    HttpStreamCallback;
 
 class HttpServer {
  public:
@@ -238,11 +268,14 @@ class HttpServer {
   virtual ~HttpServer();
   void RegisterHandler(HttpMethod method, const std::string &url,
                        HttpCallback callback);
+  void RegisterStreamHandler(HttpMethod method, const std::string &url,
+                             HttpStreamCallback callback);
   void RegisterService(const std::string &name, ApiService *service);
   void Serve(const std::string &service, const std::string &host);
 
  private:
   HttpResponse ExecuteHandler(const HttpRequest &request, ServiceMap &services);
+  std::unique_ptr<HttpStream> OpenStream(const HttpRequest &request);
   bool SetupTimerDescriptor();
   bool SetupSignalDescriptor();
   bool SetupServerSocket(const std::string &service, const std::string &host);
@@ -255,6 +288,7 @@ class HttpServer {
   void DeleteConnection(int descriptor);
   void DeleteAllConnections();
   void DeleteExpiredConnections();
+  void DropResponses(int descriptor);
   void HandleTimerError();
   void HandleTimerEvent();
   void HandleSignalError();
@@ -262,11 +296,18 @@ class HttpServer {
   void HandleServerError(const std::string &service, const std::string &host);
   void HandleServerEvent();
   void HandleClientEvent(int index);
+  void HandleNotifierEvent(int index);
+  void CommitResponses();
+  void ReleaseResponses();
   std::atomic<bool> running_;
   TcpSocket server_socket_;
   std::map<std::string, HttpCallback> handlers_;
+  std::map<std::string, HttpStreamCallback> stream_handlers_;
   Epoll epoll_;
   std::map<int, HttpConnection *> connections_;
+  std::vector<int> responses_;
+  std::deque<std::pair<std::vector<uint64_t>, std::vector<int>>> commits_;
+  std::map<int, ApiService *> notifiers_;
   sigset_t sigset_;
   int signal_descriptor_;
   struct signalfd_siginfo signal_info_;
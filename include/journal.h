@@ -15,101 +15,626 @@ limitations under the License. */
 #ifndef JOURNAL_H
 #define JOURNAL_H
 
+#include <signal.h>
+#include <sys/eventfd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
 #include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
+#include "compression.h"
 #include "json.h"
 #include "map.h"
 
 const uint8_t kStorageInsert = 0;
 const uint8_t kStorageUpdate = 1;
 const uint8_t kStorageErase = 2;
+const uint8_t kStoragePatch = 3;
+const uint8_t kStorageEraseKey = 4;
+const uint8_t kStorageBegin = 5;
+const uint8_t kStorageCommit = 6;
+
+const size_t kJournalBufferLimit = 1048576;
+const size_t kJournalBlockLimit = 4 * kJournalBufferLimit;
+const size_t kJournalFrameHeaderSize = 2 * sizeof(uint32_t);
+
+const std::string kDurabilityNone = "none";
+const std::string kDurabilityFlush = "flush";
+const std::string kDurabilitySync = "sync";
+
+enum DatabaseDurability {
+  DURABILITY_NONE = 0,
+  DURABILITY_FLUSH,
+  DURABILITY_SYNC
+};
+
+enum JournalFrameStatus {
+  FRAME_VALID = 0,
+  FRAME_END,
+  FRAME_TORN,
+  FRAME_CORRUPTED
+};
+
+class JournalWriter {
+ public:
+  JournalWriter();
+  virtual ~JournalWriter();
+  void Open(const std::string &filepath, DatabaseDurability durability,
+            CompressionCodec codec = COMPRESSION_NONE);
+  void Close();
+  bool IsOpen() const;
+  std::ostream &GetStream();
+  size_t GetBuffered();
+  uint64_t Submit();
+  uint64_t GetCommitted() const;
+  int GetNotifier() const;
+  size_t GetQueueDepth() const;
+  uint64_t GetBatches() const;
+  uint64_t GetLatencyAverage() const;
+  uint64_t GetLatencyMaximum() const;
+
+ private:
+  void Run();
+  std::ostringstream stream_;
+  std::string pending_;
+  std::vector<size_t> submissions_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::thread worker_;
+  int descriptor_;
+  int notifier_;
+  DatabaseDurability durability_;
+  CompressionCodec codec_;
+  bool stop_;
+  uint64_t submitted_;
+  std::atomic<uint64_t> committed_;
+  std::atomic<size_t> queue_depth_;
+  std::atomic<uint64_t> batches_;
+  std::atomic<uint64_t> latency_total_;
+  std::atomic<uint64_t> latency_maximum_;
+};
+
+namespace journal {
+
+JournalFrameStatus ReadFrame(EncodingReader &reader, EncodingReader &payload);
+
+}  // namespace journal
 
 template <class K, class V>
 class Journal {
  public:
-  static void Replay(const std::string &filepath, Map<K, V> &db,
-                     const std::atomic<bool> &cancel = false);
-  static void Append(std::ofstream &stream, uint8_t operation, const K &key,
+  static size_t Replay(const std::string &filepath, Map<K, V> &db,
+                       const std::atomic<bool> &cancel = false,
+                       size_t threads = 1);
+  static size_t Replay(EncodingReader &reader, Map<K, V> &db,
+                       const std::atomic<bool> &cancel = false,
+                       size_t threads = 1);
+  static void Append(std::ostream &stream, uint8_t operation, const K &key,
                      const V &value);
+  static void Append(std::ostream &stream, uint8_t operation, const K &key);
+  static void Mark(std::ostream &stream, uint8_t operation);
+
+  typedef std::vector<std::pair<K, std::pair<uint8_t, std::vector<V>>>> Delta;
+  static size_t Collect(const std::string &filepath, Delta &delta,
+                        const std::atomic<bool> &cancel = false);
+
+ private:
+  typedef std::vector<std::pair<K, std::optional<V>>> Resolution;
+  typedef std::function<void(uint8_t operation, K &key, V &value)> Visitor;
+  static size_t Scan(EncodingReader &reader,
+                     const std::function<void(EncodingReader &)> &handler,
+                     const std::atomic<bool> &cancel);
+  static size_t Visit(EncodingReader &reader, uint8_t flags,
+                      const Visitor &visitor, const std::atomic<bool> &cancel);
+  static size_t Inflate(EncodingReader &reader, uint8_t flags, uint8_t codec,
+                        const std::function<size_t(EncodingReader &)> &process,
+                        const std::atomic<bool> &cancel);
+  static size_t ReplayParallel(EncodingReader &reader, Map<K, V> &db,
+                               const std::atomic<bool> &cancel,
+                               size_t threads);
+  static void Resolve(const std::vector<EncodingReader> &records,
+                      const Map<K, V> &db, Resolution &resolution,
+                      const std::atomic<bool> &cancel);
+  static void Merge(std::vector<Resolution> &resolutions, Map<K, V> &db);
+  static void Decode(EncodingReader &payload, uint8_t &operation, K &key,
+                     V &value);
+  static std::ostringstream &Frame(std::ostream &stream, uint8_t operation);
+  static void Write(std::ostream &stream, std::ostringstream &payload);
+  static void Apply(Map<K, V> &db, uint8_t operation, const K &key,
+                    const V &value);
 };
 
 template <class K, class V>
-void Journal<K, V>::Replay(const std::string &filepath, Map<K, V> &db,
-                           const std::atomic<bool> &cancel) {
+size_t Journal<K, V>::Replay(const std::string &filepath, Map<K, V> &db,
+                             const std::atomic<bool> &cancel,
+                             size_t threads) {
+  if (!FileExists(filepath)) {
+    return 0;
+  }
+  MappedFile file;
+  if (!file.Open(filepath)) {
+    throw std::runtime_error("journal: could not map file");
+  }
+  EncodingReader reader(file.GetData(), file.Size());
+  return Replay(reader, db, cancel, threads);
+}
+
+template <class K, class V>
+size_t Journal<K, V>::Replay(EncodingReader &reader, Map<K, V> &db,
+                             const std::atomic<bool> &cancel,
+                             size_t threads) {
+  uint8_t flags;
+  uint8_t codec;
+  if (encoding::ReadHeader(reader, flags, codec) == std::string::npos) {
+    throw std::runtime_error("journal: unsupported file header");
+  }
+  return Inflate(
+      reader, flags, codec,
+      [&](EncodingReader &records) {
+        if ((flags & kEncodingFlagFramed) && threads > 1) {
+          return ReplayParallel(records, db, cancel, threads);
+        }
+        return Visit(
+            records, flags,
+            [&db](uint8_t operation, K &key, V &value) {
+              Apply(db, operation, key, value);
+            },
+            cancel);
+      },
+      cancel);
+}
+
+template <class K, class V>
+size_t Journal<K, V>::Collect(const std::string &filepath, Delta &delta,
+                              const std::atomic<bool> &cancel) {
+  delta.clear();
   if (!FileExists(filepath)) {
-    return;
+    return 0;
   }
-  std::ifstream stream;
-  size_t key_bytes = 0;
-  size_t value_bytes = 0;
-  size_t size = FileSize(filepath);
-  stream.open(filepath, std::fstream::binary);
+  MappedFile file;
+  if (!file.Open(filepath)) {
+    throw std::runtime_error("journal: could not map file");
+  }
+  EncodingReader reader(file.GetData(), file.Size());
+  uint8_t flags;
+  uint8_t codec;
+  if (encoding::ReadHeader(reader, flags, codec) == std::string::npos) {
+    throw std::runtime_error("journal: unsupported file header");
+  }
+  std::unordered_map<K, std::pair<uint8_t, std::vector<V>>> states;
+  Visitor visitor = [&states](uint8_t operation, K &key, V &value) {
+    auto state = states.find(key);
+    switch (operation) {
+      case kStorageInsert:
+      case kStorageUpdate:
+        if (state == states.end()) {
+          state = states.emplace(key, std::make_pair(kStorageUpdate,
+                                                     std::vector<V>()))
+                      .first;
+        } else if (operation == kStorageInsert &&
+                   state->second.first != kStorageErase) {
+          throw std::runtime_error("journal: insert existing key " + key);
+        } else if (operation == kStorageUpdate &&
+                   state->second.first == kStorageErase) {
+          throw std::runtime_error("journal: update non-existent key " +
+                                   key);
+        }
+        state->second.first = kStorageUpdate;
+        state->second.second.clear();
+        state->second.second.push_back(std::move(value));
+        break;
+      case kStorageErase:
+      case kStorageEraseKey:
+        states[key] = std::make_pair(kStorageErase, std::vector<V>());
+        break;
+      case kStoragePatch:
+        if (state == states.end()) {
+          state = states.emplace(key, std::make_pair(kStoragePatch,
+                                                     std::vector<V>()))
+                      .first;
+        }
+        if (state->second.first == kStorageErase) {
+          throw std::runtime_error("journal: patch non-existent key " +
+                                   key);
+        } else if (state->second.first == kStorageUpdate) {
+          Patcher<V>::Patch(state->second.second.front(), value);
+        } else {
+          state->second.second.push_back(std::move(value));
+        }
+        break;
+      default:
+        throw std::runtime_error("journal: unknown storage modification");
+    }
+  };
+  size_t bytes = Inflate(
+      reader, flags, codec,
+      [&](EncodingReader &records) {
+        return Visit(records, flags, visitor, cancel);
+      },
+      cancel);
+  delta.reserve(states.size());
+  for (auto &state : states) {
+    delta.emplace_back(state.first, std::move(state.second));
+  }
+  std::sort(delta.begin(), delta.end(),
+            [](const auto &a, const auto &b) { return a.first < b.first; });
+  return bytes;
+}
+
+template <class K, class V>
+size_t Journal<K, V>::Visit(EncodingReader &reader, uint8_t flags,
+                            const Visitor &visitor,
+                            const std::atomic<bool> &cancel) {
   uint8_t operation;
   K key;
   V value;
-  size_t bytes = 0;
-  while (bytes < size) {
+  if (flags & kEncodingFlagFramed) {
+    return Scan(
+        reader,
+        [&](EncodingReader &payload) {
+          Decode(payload, operation, key, value);
+          visitor(operation, key, value);
+        },
+        cancel);
+  }
+  while (reader.Remaining() > 0) {
     if (cancel) {
-      return;
+      return reader.Offset();
     }
-    stream.read((char *)&operation, sizeof(uint8_t));
-    bytes += sizeof(uint8_t);
-    if (!stream) {
+    if (encoding::ReadBytes(reader, &operation, sizeof(uint8_t)) ==
+        std::string::npos) {
       throw std::runtime_error("journal: could not read storage modification");
     }
-    key_bytes = Serializer<K>::Deserialize(key, stream);
-    if (key_bytes == std::string::npos) {
+    if (Serializer<K>::Deserialize(key, reader) == std::string::npos) {
       throw std::runtime_error("journal: could not read key");
     }
-    bytes += key_bytes;
-    value_bytes = Serializer<V>::Deserialize(value, stream);
-    if (value_bytes == std::string::npos) {
+    if (Serializer<V>::Deserialize(value, reader) == std::string::npos) {
       throw std::runtime_error("journal: could not read value");
     }
-    bytes += value_bytes;
-    MapIterator<K, V> iterator;
+    visitor(operation, key, value);
+  }
+  return reader.Offset();
+}
+
+template <class K, class V>
+size_t Journal<K, V>::Inflate(
+    EncodingReader &reader, uint8_t flags, uint8_t codec,
+    const std::function<size_t(EncodingReader &)> &process,
+    const std::atomic<bool> &cancel) {
+  if (!(flags & kEncodingFlagCompressed)) {
+    return process(reader);
+  }
+  std::string records;
+  std::vector<std::pair<size_t, size_t>> blocks;
+  EncodingReader block(nullptr, 0);
+  size_t offset;
+  for (;;) {
+    offset = reader.Offset();
+    JournalFrameStatus status = journal::ReadFrame(reader, block);
+    if (status == FRAME_CORRUPTED) {
+      throw std::runtime_error("journal: block checksum mismatch");
+    }
+    blocks.emplace_back(records.length(), offset);
+    if (status != FRAME_VALID) {
+      break;
+    }
+    if (!compression::Decompress((CompressionCodec)codec, block.Current(),
+                                 block.Remaining(), records,
+                                 kCompressionBlockMaximum)) {
+      throw std::runtime_error("journal: could not decompress block");
+    }
+  }
+  EncodingReader inner(records.data(), records.length());
+  inner.SetVersion(reader.GetVersion());
+  size_t bytes = process(inner);
+  auto lookup = std::upper_bound(
+      blocks.begin(), blocks.end(), bytes,
+      [](size_t value, const auto &entry) { return value < entry.first; });
+  lookup--;
+  if (lookup->first != bytes && !cancel) {
+    throw std::runtime_error("journal: torn batch inside compressed block");
+  }
+  return lookup->second;
+}
+
+template <class K, class V>
+size_t Journal<K, V>::Scan(
+    EncodingReader &reader,
+    const std::function<void(EncodingReader &)> &handler,
+    const std::atomic<bool> &cancel) {
+  std::vector<EncodingReader> batch;
+  size_t batch_offset = std::string::npos;
+  size_t offset;
+  EncodingReader payload(nullptr, 0);
+  for (;;) {
+    if (cancel) {
+      return reader.Offset();
+    }
+    offset = reader.Offset();
+    switch (journal::ReadFrame(reader, payload)) {
+      case FRAME_VALID:
+        break;
+      case FRAME_CORRUPTED:
+        throw std::runtime_error("journal: record checksum mismatch");
+      default:
+        return batch_offset != std::string::npos ? batch_offset
+                                                 : reader.Offset();
+    }
+    switch ((uint8_t)*payload.Current()) {
+      case kStorageBegin:
+        if (batch_offset != std::string::npos) {
+          throw std::runtime_error("journal: nested batch");
+        }
+        batch_offset = offset;
+        break;
+      case kStorageCommit:
+        if (batch_offset == std::string::npos) {
+          throw std::runtime_error("journal: commit without batch");
+        }
+        for (EncodingReader &record : batch) {
+          handler(record);
+        }
+        batch.clear();
+        batch_offset = std::string::npos;
+        break;
+      default:
+        if (batch_offset != std::string::npos) {
+          batch.push_back(payload);
+        } else {
+          handler(payload);
+        }
+    }
+  }
+}
+
+template <class K, class V>
+size_t Journal<K, V>::ReplayParallel(EncodingReader &reader, Map<K, V> &db,
+                                     const std::atomic<bool> &cancel,
+                                     size_t threads) {
+  std::vector<std::vector<EncodingReader>> partitions(threads);
+  std::hash<K> hash;
+  uint8_t operation;
+  K key;
+  size_t bytes = Scan(
+      reader,
+      [&](EncodingReader &payload) {
+        EncodingReader record = payload;
+        if (encoding::ReadBytes(payload, &operation, sizeof(uint8_t)) ==
+                std::string::npos ||
+            Serializer<K>::Deserialize(key, payload) == std::string::npos) {
+          throw std::runtime_error("journal: could not read key");
+        }
+        partitions[hash(key) % threads].push_back(record);
+      },
+      cancel);
+  std::vector<Resolution> resolutions(threads);
+  std::vector<std::exception_ptr> errors(threads);
+  std::vector<std::thread> workers;
+  for (size_t idx = 0; idx < threads; idx++) {
+    workers.emplace_back([&, idx] {
+      try {
+        Resolve(partitions[idx], db, resolutions[idx], cancel);
+      } catch (...) {
+        errors[idx] = std::current_exception();
+      }
+    });
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  for (auto &error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+  if (!cancel) {
+    Merge(resolutions, db);
+  }
+  return bytes;
+}
+
+template <class K, class V>
+void Journal<K, V>::Resolve(const std::vector<EncodingReader> &records,
+                            const Map<K, V> &db, Resolution &resolution,
+                            const std::atomic<bool> &cancel) {
+  std::unordered_map<K, std::optional<V>> states;
+  uint8_t operation;
+  K key;
+  V value;
+  for (EncodingReader payload : records) {
+    if (cancel) {
+      return;
+    }
+    Decode(payload, operation, key, value);
+    auto state = states.find(key);
+    if (state == states.end()) {
+      std::optional<V> current;
+      MapIterator<K, V> iterator = db.Find(key);
+      if (iterator != db.End()) {
+        current = operation == kStoragePatch ? iterator.GetValue() : V();
+      }
+      state = states.emplace(key, std::move(current)).first;
+    }
     switch (operation) {
       case kStorageInsert:
-        db.Insert(key, value);
+        if (state->second) {
+          throw std::runtime_error("journal: insert existing key " + key);
+        }
+        state->second = std::move(value);
         break;
       case kStorageUpdate:
-        iterator = db.Find(key);
-        if (iterator != db.End()) {
-          db.Update(iterator, value);
-        } else {
+        if (!state->second) {
           throw std::runtime_error("journal: update non-existent key " + key);
         }
+        state->second = std::move(value);
         break;
       case kStorageErase:
-        db.Erase(key);
+      case kStorageEraseKey:
+        state->second.reset();
+        break;
+      case kStoragePatch:
+        if (!state->second) {
+          throw std::runtime_error("journal: patch non-existent key " + key);
+        }
+        Patcher<V>::Patch(*state->second, value);
         break;
       default:
         throw std::runtime_error("journal: unknown storage modification");
     }
   }
-  stream.close();
-  if (!stream) {
-    throw std::runtime_error("journal: invalidated stream");
+  resolution.reserve(states.size());
+  for (auto &state : states) {
+    resolution.emplace_back(state.first, std::move(state.second));
   }
+  std::sort(resolution.begin(), resolution.end(),
+            [](const auto &a, const auto &b) { return a.first < b.first; });
 }
 
 template <class K, class V>
-void Journal<K, V>::Append(std::ofstream &stream, uint8_t operation,
-                           const K &key, const V &value) {
-  stream.write((const char *)&operation, sizeof(uint8_t));
-  if (!stream) {
-    throw std::runtime_error("journal: could write operation");
+void Journal<K, V>::Merge(std::vector<Resolution> &resolutions, Map<K, V> &db) {
+  std::vector<size_t> positions(resolutions.size(), 0);
+  for (;;) {
+    size_t next = std::string::npos;
+    for (size_t idx = 0; idx < resolutions.size(); idx++) {
+      if (positions[idx] < resolutions[idx].size() &&
+          (next == std::string::npos ||
+           resolutions[idx][positions[idx]].first <
+               resolutions[next][positions[next]].first)) {
+        next = idx;
+      }
+    }
+    if (next == std::string::npos) {
+      return;
+    }
+    auto &entry = resolutions[next][positions[next]++];
+    MapIterator<K, V> iterator = db.Find(entry.first);
+    if (!entry.second) {
+      if (iterator != db.End()) {
+        db.Erase(iterator);
+      }
+    } else if (iterator != db.End()) {
+      db.Update(iterator, *entry.second);
+    } else {
+      db.Insert(entry.first, *entry.second);
+    }
+    entry.second.reset();
+  }
+}
+
+template <class K, class V>
+void Journal<K, V>::Decode(EncodingReader &payload, uint8_t &operation, K &key,
+                           V &value) {
+  if (encoding::ReadBytes(payload, &operation, sizeof(uint8_t)) ==
+      std::string::npos) {
+    throw std::runtime_error("journal: could not read storage modification");
+  }
+  if (Serializer<K>::Deserialize(key, payload) == std::string::npos) {
+    throw std::runtime_error("journal: could not read key");
   }
-  if (Serializer<K>::Serialize(key, stream) == std::string::npos) {
+  if (operation != kStorageEraseKey &&
+      Serializer<V>::Deserialize(value, payload) == std::string::npos) {
+    throw std::runtime_error("journal: could not read value");
+  }
+  if (payload.Remaining() > 0) {
+    throw std::runtime_error("journal: trailing bytes in record");
+  }
+}
+
+template <class K, class V>
+void Journal<K, V>::Apply(Map<K, V> &db, uint8_t operation, const K &key,
+                          const V &value) {
+  MapIterator<K, V> iterator;
+  switch (operation) {
+    case kStorageInsert:
+      db.Insert(key, value);
+      break;
+    case kStorageUpdate:
+      iterator = db.Find(key);
+      if (iterator != db.End()) {
+        db.Update(iterator, value);
+      } else {
+        throw std::runtime_error("journal: update non-existent key " + key);
+      }
+      break;
+    case kStorageErase:
+    case kStorageEraseKey:
+      db.Erase(key);
+      break;
+    case kStoragePatch:
+      iterator = db.Find(key);
+      if (iterator != db.End()) {
+        db.Patch(iterator, value);
+      } else {
+        throw std::runtime_error("journal: patch non-existent key " + key);
+      }
+      break;
+    default:
+      throw std::runtime_error("journal: unknown storage modification");
+  }
+}
+
+template <class K, class V>
+void Journal<K, V>::Append(std::ostream &stream, uint8_t operation,
+                           const K &key, const V &value) {
+  std::ostringstream &payload = Frame(stream, operation);
+  if (Serializer<K>::Serialize(key, payload) == std::string::npos) {
     throw std::runtime_error("journal: could append key");
   }
-  if (Serializer<V>::Serialize(value, stream) == std::string::npos) {
+  if (Serializer<V>::Serialize(value, payload) == std::string::npos) {
     throw std::runtime_error("journal: could not append value");
   }
-  stream.flush();
+  Write(stream, payload);
+}
+
+template <class K, class V>
+void Journal<K, V>::Append(std::ostream &stream, uint8_t operation,
+                           const K &key) {
+  std::ostringstream &payload = Frame(stream, operation);
+  if (Serializer<K>::Serialize(key, payload) == std::string::npos) {
+    throw std::runtime_error("journal: could append key");
+  }
+  Write(stream, payload);
+}
+
+template <class K, class V>
+void Journal<K, V>::Mark(std::ostream &stream, uint8_t operation) {
+  Write(stream, Frame(stream, operation));
+}
+
+template <class K, class V>
+std::ostringstream &Journal<K, V>::Frame(std::ostream &stream,
+                                         uint8_t operation) {
+  static thread_local std::ostringstream payload;
+  payload.clear();
+  payload.seekp(0);
+  encoding::SetVersion(payload, encoding::GetVersion(stream));
+  payload.write((const char *)&operation, sizeof(uint8_t));
+  if (!payload) {
+    throw std::runtime_error("journal: could write operation");
+  }
+  return payload;
+}
+
+template <class K, class V>
+void Journal<K, V>::Write(std::ostream &stream, std::ostringstream &payload) {
+  uint32_t length = payload.tellp();
+  const char *data = payload.view().data();
+  uint32_t checksum = encoding::Crc32c(data, length);
+  stream.write((const char *)&length, sizeof(uint32_t));
+  stream.write((const char *)&checksum, sizeof(uint32_t));
+  stream.write(data, length);
   if (!stream) {
-    throw std::runtime_error("journal: invalidated stream");
+    throw std::runtime_error("journal: could not append record");
   }
 }
 
@@ -17,16 +17,26 @@ limitations under the License. */
 
 #include <algorithm>
 #include <any>
+#include <atomic>
 #include <cassert>
+#include <charconv>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <deque>
 #include <iomanip>
 #include <map>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <shared_mutex>
 #include <sstream>
 #include <string>
+#include <unordered_map>
 #include <variant>
 #include <vector>
 
+#include "encoding.h"
 #include "rand.h"
 #include "utils.h"
 
@@ -35,12 +45,27 @@ const std::vector<std::string> kJsonKeySet = {
     "rOv9Tq5u", "lKKdJAFt", "fsm9iOxx", "BiyEstkf", "9IKxj6Qw", "c8EwQ9n9"};
 
 typedef std::any JsonValue;
+class JsonShape;
+class JsonDictionary;
+class JsonDecoder;
+class JsonLazy;
+class JsonSymbol;
+class JsonStringPool;
+class JsonStreamParser;
+class JsonPath;
+class JsonReference;
 class JsonArray;
 class JsonObject;
 typedef bool JsonBoolean;
 typedef int64_t JsonInteger;
 typedef double JsonFloat;
 typedef std::string JsonString;
+typedef std::variant<JsonInteger, JsonFloat> JsonNumber;
+typedef std::pmr::vector<JsonValue> JsonValues;
+typedef std::pmr::vector<JsonInteger> JsonIntegers;
+typedef std::pmr::vector<JsonFloat> JsonFloats;
+typedef std::pmr::vector<std::pmr::string> JsonStrings;
+typedef std::pair<const std::string, std::atomic<size_t>> JsonSymbolEntry;
 
 const std::string kJsonNull = "null";
 const std::string kJsonFalse = "false";
@@ -57,6 +82,35 @@ const uint8_t kJsonTypeFloat = 3;
 const uint8_t kJsonTypeString = 4;
 const uint8_t kJsonTypeObject = 5;
 const uint8_t kJsonTypeArray = 6;
+const uint8_t kJsonTypeLazy = 7;
+const uint8_t kJsonTypeSymbol = 8;
+
+const size_t kJsonShapeMaximumKeys = 32;
+const size_t kJsonShapeMaximumCount = 4096;
+const size_t kJsonDictionaryFlatMaximum = 16;
+const size_t kJsonSymbolMaximumLength = 32;
+const size_t kJsonSymbolThreshold = 2;
+const size_t kJsonSymbolCandidateMaximum = 65536;
+const std::string kJsonStreamTokens = "\"{}[]";
+const size_t kJsonNumberMaximumLength = 32;
+const uint64_t kJsonHashMultiplier = 0x9e3779b97f4a7c15ULL;
+const uint64_t kJsonHashNull = 0x6e756c6c;
+const uint64_t kJsonHashBoolean = 0x626f6f6c;
+const uint64_t kJsonHashInteger = 0x696e7465676572;
+const uint64_t kJsonHashFloat = 0x666c6f6174;
+const uint64_t kJsonHashString = 0x737472696e67;
+const uint64_t kJsonHashObject = 0x6f626a656374;
+const uint64_t kJsonHashArray = 0x6172726179;
+
+enum JsonStreamStage {
+  STREAM_OPEN = 0,
+  STREAM_FIRST,
+  STREAM_VALUE,
+  STREAM_ELEMENT,
+  STREAM_SEPARATOR,
+  STREAM_CLOSED,
+  STREAM_FAILED
+};
 
 namespace json {
 
@@ -66,16 +120,151 @@ bool IsBoolean(const JsonValue &value);
 bool IsInteger(const JsonValue &value);
 bool IsFloat(const JsonValue &value);
 bool IsString(const JsonValue &value);
+const JsonString &GetString(const JsonValue &value);
+uint64_t Hash(const JsonValue &value);
+bool Equal(const JsonValue &value, const JsonValue &other);
+void WriteCanonical(const JsonValue &value, std::string &target);
+void WriteCanonical(const JsonObject &object, std::string &target);
+void WriteCanonical(const JsonArray &array, std::string &target);
+bool ParseNumber(const std::string &source, size_t &offset,
+                 JsonNumber &number);
+bool Skip(const std::string &source, size_t &offset);
+
+size_t Serialize(const JsonObject &object, std::ostream &stream);
+size_t Deserialize(JsonObject &object, std::istream &stream);
+size_t Deserialize(JsonObject &object, EncodingReader &reader);
+size_t Serialize(const JsonArray &object, std::ostream &stream);
+size_t Deserialize(JsonArray &object, std::istream &stream);
+size_t Deserialize(JsonArray &object, EncodingReader &reader);
+
+uint64_t Memory(const JsonObject &object);
+uint64_t Memory(const JsonArray &object);
 
 }  // namespace json
 
+class JsonShape {
+ public:
+  virtual ~JsonShape();
+  size_t Size() const;
+  size_t Find(const std::string &key) const;
+  const std::string &Key(size_t index) const;
+  const std::vector<std::string> &Keys() const;
+  static std::shared_ptr<const JsonShape> Transition(
+      const std::shared_ptr<const JsonShape> &shape, const std::string &key);
+  static size_t Count();
+
+ private:
+  JsonShape();
+  std::vector<std::string> keys_;
+  std::shared_ptr<const JsonShape> parent_;
+  mutable std::map<std::string, std::weak_ptr<const JsonShape>> transitions_;
+  static std::shared_mutex mutex_;
+  static std::atomic<size_t> count_;
+};
+
+class JsonDictionary {
+ public:
+  JsonDictionary();
+  JsonDictionary(const JsonDictionary &dictionary);
+  virtual ~JsonDictionary();
+  size_t Size() const;
+  size_t Capacity() const;
+  bool IsFlat() const;
+  const std::string &Key(size_t index) const;
+  const JsonValue &Value(size_t index) const;
+  JsonValue &Value(size_t index);
+  size_t Find(const std::string &key) const;
+  bool Insert(const std::string &key, JsonValue &&value);
+  void Assign(size_t index, JsonValue &&value);
+  void Erase(size_t index);
+  void Reserve(size_t size);
+
+ private:
+  std::vector<std::pair<std::string, JsonValue>> members_;
+  std::unique_ptr<std::unordered_map<std::string, size_t>> index_;
+};
+
+class JsonLazy {
+ public:
+  JsonLazy();
+  JsonLazy(const std::string &source);
+  JsonLazy(const std::string &source, size_t begin, size_t end);
+  virtual ~JsonLazy();
+  bool IsObject() const;
+  bool IsArray() const;
+  JsonObject GetObject() const;
+  JsonArray GetArray() const;
+  const std::string &GetSource() const;
+
+ private:
+  std::string source_;
+};
+
+class JsonSymbol {
+ public:
+  JsonSymbol(JsonSymbolEntry *entry);
+  JsonSymbol(const JsonSymbol &symbol);
+  JsonSymbol(JsonSymbol &&symbol) noexcept;
+  ~JsonSymbol();
+  JsonSymbol &operator=(const JsonSymbol &symbol);
+  bool operator==(const JsonSymbol &other) const;
+  bool operator!=(const JsonSymbol &other) const;
+  const std::string &GetString() const;
+
+ private:
+  JsonSymbolEntry *entry_;
+};
+
+class JsonStringPool {
+ public:
+  JsonStringPool();
+  virtual ~JsonStringPool();
+  size_t Size() const;
+  bool Intern(JsonValue &value);
+  size_t Purge();
+  uint64_t Memory() const;
+
+ private:
+  std::unordered_map<std::string, std::atomic<size_t>> entries_;
+  std::unordered_map<std::string, size_t> candidates_;
+};
+
+class JsonStreamParser {
+ public:
+  JsonStreamParser();
+  virtual ~JsonStreamParser();
+  void Feed(const std::string &chunk);
+  bool Next(std::string &element);
+  bool IsComplete() const;
+  size_t Count() const;
+
+ private:
+  void Emit(const std::string &chunk, size_t begin, size_t end);
+  void Fail(const std::string &message);
+  JsonStreamStage stage_;
+  bool string_;
+  std::string nesting_;
+  std::string element_;
+  std::deque<std::string> elements_;
+  size_t count_;
+};
+
 class JsonArray {
  public:
   friend class JsonObject;
+  friend size_t json::Serialize(const JsonArray &object, std::ostream &stream);
+  friend uint64_t json::Memory(const JsonArray &object);
+  friend void json::WriteCanonical(const JsonArray &array, std::string &target);
+  friend class JsonDecoder;
+  friend class JsonPath;
+  friend class JsonReference;
   JsonArray();
   JsonArray(const JsonArray &array);
+  JsonArray(std::pmr::memory_resource *resource);
   JsonArray(const std::string &source);
   virtual ~JsonArray();
+  bool operator==(const JsonArray &other) const;
+  bool operator!=(const JsonArray &other) const;
   size_t Size() const;
   void PutNull();
   void PutBoolean(JsonBoolean value);
@@ -98,22 +287,42 @@ class JsonArray {
   bool IsString(size_t index) const;
   bool IsObject(size_t index) const;
   bool IsArray(size_t index) const;
+  bool IsPacked() const;
+  void Intern(JsonStringPool &pool);
   void Clear();
+  uint64_t Hash() const;
   std::string String() const;
+  std::string CanonicalString() const;
   void Parse(const std::string &source);
+  void ParseLazy(const std::string &source);
 
  private:
-  std::vector<JsonValue> values_;
-  void Parse(const std::string &source, size_t &source_offset);
+  std::variant<JsonValues, JsonIntegers, JsonFloats, JsonStrings> values_;
+  std::pmr::memory_resource *Resource() const;
+  bool Pack(size_t storage);
+  JsonValues &Generalize();
+  void Put(JsonValue &&value);
+  void Parse(const std::string &source, size_t &source_offset, bool lazy);
 };
 
 class JsonObject {
  public:
   friend class JsonArray;
+  friend size_t json::Serialize(const JsonObject &object, std::ostream &stream);
+  friend class JsonDecoder;
+  friend class JsonPath;
+  friend uint64_t json::Memory(const JsonObject &object);
+  friend void json::WriteCanonical(const JsonObject &object,
+                                   std::string &target);
   JsonObject();
   JsonObject(const JsonObject &object);
+  JsonObject(JsonObject &&object);
   JsonObject(const std::string &source);
   virtual ~JsonObject();
+  JsonObject &operator=(const JsonObject &object);
+  JsonObject &operator=(JsonObject &&object);
+  bool operator==(const JsonObject &other) const;
+  bool operator!=(const JsonObject &other) const;
   bool Has(const std::string &key) const;
   void PutNull(const std::string &key);
   void PutBoolean(const std::string &key, JsonBoolean value);
@@ -122,6 +331,8 @@ class JsonObject {
   void PutString(const std::string &key, const JsonString &value);
   void PutObject(const std::string &key, const JsonObject &value);
   void PutArray(const std::string &key, const JsonArray &value);
+  bool Erase(const std::string &key);
+  void Patch(const JsonObject &patch);
   JsonValue GetValue(const std::string &key) const;
   JsonBoolean GetBoolean(const std::string &key) const;
   JsonInteger GetInteger(const std::string &key) const;
@@ -137,25 +348,31 @@ class JsonObject {
   bool IsObject(const std::string &key) const;
   bool IsArray(const std::string &key) const;
   std::vector<std::string> Keys() const;
+  size_t Size() const;
+  bool IsShaped() const;
+  void Intern(JsonStringPool &pool);
   void Clear();
+  uint64_t Hash() const;
   std::string String() const;
+  std::string CanonicalString() const;
   void Parse(const std::string &source);
+  void ParseLazy(const std::string &source);
 
  private:
-  std::unordered_map<std::string, JsonValue> values_;
-  void Parse(const std::string &source, size_t &source_offset);
+  std::shared_ptr<const JsonShape> shape_;
+  std::vector<JsonValue> slots_;
+  std::unique_ptr<JsonDictionary> dictionary_;
+  mutable uint64_t hash_;
+  void Put(const std::string &key, JsonValue &&value);
+  void Set(const std::string &key, JsonValue &&value);
+  const JsonValue &At(const std::string &key) const;
+  const JsonValue *Lookup(const std::string &key) const;
+  void MakeDictionary();
+  void Parse(const std::string &source, size_t &source_offset, bool lazy);
 };
 
 namespace json {
 
-size_t Serialize(const JsonObject &object, std::ostream &stream);
-size_t Deserialize(JsonObject &object, std::istream &stream);
-size_t Serialize(const JsonArray &object, std::ostream &stream);
-size_t Deserialize(JsonArray &object, std::istream &stream);
-
-uint64_t Memory(const JsonObject &object);
-uint64_t Memory(const JsonArray &object);
-
 JsonObject RandomObject(Random &random);
 JsonArray RandomObjectArray(Random &random);
 
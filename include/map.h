@@ -32,6 +32,7 @@ limitations under the License. */
 #include <tuple>
 #include <vector>
 
+#include "document.h"
 #include "json.h"
 #include "log.h"
 #include "trace.h"
@@ -80,6 +81,8 @@ template <>
 class Serializer<JsonObject>;
 template <>
 class Serializer<JsonArray>;
+template <>
+class Serializer<BinaryDocument>;
 template <class K, class V>
 class Serializer<Map<K, V>>;
 
@@ -101,9 +104,16 @@ template <>
 class Memory<JsonObject>;
 template <>
 class Memory<JsonArray>;
+template <>
+class Memory<BinaryDocument>;
 template <class K, class V>
 class Memory<Map<K, V>>;
 
+template <class T>
+class Patcher;
+template <>
+class Patcher<JsonObject>;
+
 class Node {
  public:
   Node() {}
@@ -734,7 +744,10 @@ class Map {
   void Clear();
   size_t Size() const;
   void Insert(const K &key, const V &value);
+  void Load(std::vector<std::vector<std::pair<K, V>>> &chunks);
   void Update(const MapIterator<K, V> &iterator, const V &value);
+  void Patch(const MapIterator<K, V> &iterator, const V &patch);
+  void Apply(const std::function<void(V &value)> &function);
   const V &operator[](const K &key) const;
   V &operator[](const K &key);
   bool Erase(const K &key);
@@ -973,6 +986,23 @@ void Map<K, V>::Update(const MapIterator<K, V> &iterator, const V &value) {
   iterator.node_->values_[iterator.index_] = value;
 }
 
+template <class K, class V>
+void Map<K, V>::Patch(const MapIterator<K, V> &iterator, const V &patch) {
+  STACKTRACE;
+  if (iterator.node_ == nullptr || (iterator.index_ == std::string::npos)) {
+    throw std::runtime_error("tree: invalid patch");
+  }
+  Patcher<V>::Patch(iterator.node_->values_[iterator.index_], patch);
+}
+
+template <class K, class V>
+void Map<K, V>::Apply(const std::function<void(V &value)> &function) {
+  STACKTRACE;
+  for (MapIterator<K, V> iterator = Begin(); iterator != End(); iterator++) {
+    function(iterator.Value());
+  }
+}
+
 template <class K, class V>
 void Map<K, V>::Insert(const K &key, const V &value) {
   STACKTRACE;
@@ -994,6 +1024,67 @@ void Map<K, V>::Insert(const K &key, const V &value) {
   }
 }
 
+template <class K, class V>
+void Map<K, V>::Load(std::vector<std::vector<std::pair<K, V>>> &chunks) {
+  STACKTRACE;
+  Clear();
+  size_t size = 0;
+  const K *last = nullptr;
+  for (auto &chunk : chunks) {
+    for (auto &entry : chunk) {
+      if (last != nullptr && !(*last < entry.first)) {
+        throw std::runtime_error("tree: bulk load of unordered keys");
+      }
+      last = &entry.first;
+      size++;
+    }
+  }
+  if (size == 0) {
+    return;
+  }
+  std::vector<std::pair<Node *, K>> level;
+  size_t nodes = (size + OUTER_FANOUT - 1) / OUTER_FANOUT;
+  size_t capacity = 0;
+  OuterNode<K, V> *outer = nullptr;
+  for (auto &chunk : chunks) {
+    for (auto &entry : chunk) {
+      if (outer == nullptr || outer->keys_.size() == capacity) {
+        OuterNode<K, V> *next = new OuterNode<K, V>();
+        next->previous_ = outer;
+        if (outer != nullptr) {
+          outer->next_ = next;
+        }
+        outer = next;
+        capacity = size / nodes + (level.size() < size % nodes ? 1 : 0);
+        level.emplace_back(outer, entry.first);
+      }
+      outer->keys_.push_back(std::move(entry.first));
+      outer->values_.push_back(std::move(entry.second));
+    }
+  }
+  while (level.size() > 1) {
+    std::vector<std::pair<Node *, K>> parents;
+    nodes = (level.size() + INNER_FANOUT) / (INNER_FANOUT + 1);
+    InnerNode<K, V> *inner = nullptr;
+    for (auto &kid : level) {
+      if (inner == nullptr || inner->kids_.size() == capacity) {
+        inner = new InnerNode<K, V>();
+        capacity = level.size() / nodes +
+                   (parents.size() < level.size() % nodes ? 1 : 0);
+        parents.emplace_back(inner, std::move(kid.second));
+      } else {
+        inner->keys_.push_back(std::move(kid.second));
+      }
+      kid.first->SetParent(inner);
+      inner->kids_.push_back(kid.first);
+    }
+    level = std::move(parents);
+  }
+  root_ = level.front().first;
+  root_->SetParent(nullptr);
+  size_ = size;
+}
+
 template <class K, class V>
 MapIterator<K, V> Map<K, V>::Erase(const MapIterator<K, V> &iterator) {
   STACKTRACE;
@@ -1766,6 +1857,10 @@ class Serializer {
     stream.read((char *)&object, sizeof(T));
     return stream ? sizeof(T) : std::string::npos;
   }
+  static size_t Deserialize(T &object, EncodingReader &reader,
+                            const std::atomic<bool> &cancel = false) {
+    return encoding::ReadBytes(reader, &object, sizeof(T));
+  }
 };
 
 template <>
@@ -1773,19 +1868,16 @@ class Serializer<std::string> {
  public:
   static size_t Serialize(const std::string &object, std::ostream &stream,
                           const std::atomic<bool> &cancel = false) {
-    size_t length = object.length();
-    stream.write((const char *)&length, sizeof(size_t));
-    stream.write((const char *)&object[0], length);
-    return stream ? sizeof(size_t) + length : std::string::npos;
+    return encoding::WriteString(stream, object);
   }
   static size_t Deserialize(std::string &object, std::istream &stream,
                             const std::atomic<bool> &cancel = false) {
     object.clear();
-    size_t length;
-    stream.read((char *)&length, sizeof(size_t));
-    object.resize(length);
-    stream.read((char *)&object[0], length);
-    return stream ? sizeof(size_t) + length : std::string::npos;
+    return encoding::ReadString(stream, object);
+  }
+  static size_t Deserialize(std::string &object, EncodingReader &reader,
+                            const std::atomic<bool> &cancel = false) {
+    return encoding::ReadString(reader, object);
   }
 };
 
@@ -2007,6 +2099,10 @@ class Serializer<JsonArray> {
                             const std::atomic<bool> &cancel = false) {
     return json::Deserialize(object, stream);
   }
+  static size_t Deserialize(JsonArray &object, EncodingReader &reader,
+                            const std::atomic<bool> &cancel = false) {
+    return json::Deserialize(object, reader);
+  }
 };
 
 template <>
@@ -2020,6 +2116,27 @@ class Serializer<JsonObject> {
                             const std::atomic<bool> &cancel = false) {
     return json::Deserialize(object, stream);
   }
+  static size_t Deserialize(JsonObject &object, EncodingReader &reader,
+                            const std::atomic<bool> &cancel = false) {
+    return json::Deserialize(object, reader);
+  }
+};
+
+template <>
+class Serializer<BinaryDocument> {
+ public:
+  static size_t Serialize(const BinaryDocument &object, std::ostream &stream,
+                          const std::atomic<bool> &cancel = false) {
+    return document::Serialize(object, stream);
+  }
+  static size_t Deserialize(BinaryDocument &object, std::istream &stream,
+                            const std::atomic<bool> &cancel = false) {
+    return document::Deserialize(object, stream);
+  }
+  static size_t Deserialize(BinaryDocument &object, EncodingReader &reader,
+                            const std::atomic<bool> &cancel = false) {
+    return document::Deserialize(object, reader);
+  }
 };
 
 template <class K, class V>
@@ -2029,6 +2146,8 @@ class Serializer<Map<K, V>> {
                           const std::atomic<bool> &cancel = false);
   static size_t Deserialize(Map<K, V> &object, std::istream &stream,
                             const std::atomic<bool> &cancel = false);
+  static size_t Deserialize(Map<K, V> &object, EncodingReader &reader,
+                            const std::atomic<bool> &cancel = false);
 };
 
 template <class K, class V>
@@ -2037,8 +2156,7 @@ size_t Serializer<Map<K, V>>::Serialize(const Map<K, V> &object,
                                         const std::atomic<bool> &cancel) {
   size_t bytes = 0;
   size_t size = object.Size();
-  stream.write((const char *)&size, sizeof(size_t));
-  bytes += sizeof(size_t);
+  bytes += encoding::WriteLength(stream, size);
   if (object.root_ == nullptr) {
     return bytes;
   }
@@ -2073,8 +2191,10 @@ size_t Serializer<Map<K, V>>::Deserialize(Map<K, V> &object,
   size_t bytes = 0;
   object.Clear();
   size_t size;
-  stream.read((char *)&size, sizeof(size_t));
-  bytes += sizeof(size_t);
+  bytes = encoding::ReadLength(stream, size);
+  if (bytes == std::string::npos) {
+    return bytes;
+  }
   std::pair<K, V> key_value_pair;
   for (size_t i = 0; i < size; i++) {
     if (cancel) {
@@ -2087,6 +2207,37 @@ size_t Serializer<Map<K, V>>::Deserialize(Map<K, V> &object,
   return stream ? bytes : std::string::npos;
 }
 
+template <class K, class V>
+size_t Serializer<Map<K, V>>::Deserialize(Map<K, V> &object,
+                                          EncodingReader &reader,
+                                          const std::atomic<bool> &cancel) {
+  object.Clear();
+  size_t size;
+  size_t bytes = encoding::ReadLength(reader, size);
+  if (bytes == std::string::npos) {
+    return bytes;
+  }
+  std::pair<K, V> key_value_pair;
+  size_t key_bytes;
+  size_t value_bytes;
+  for (size_t i = 0; i < size; i++) {
+    if (cancel) {
+      return std::string::npos;
+    }
+    key_bytes = Serializer<K>::Deserialize(key_value_pair.first, reader);
+    if (key_bytes == std::string::npos) {
+      return key_bytes;
+    }
+    value_bytes = Serializer<V>::Deserialize(key_value_pair.second, reader);
+    if (value_bytes == std::string::npos) {
+      return value_bytes;
+    }
+    bytes += key_bytes + value_bytes;
+    object.Insert(key_value_pair.first, key_value_pair.second);
+  }
+  return bytes;
+}
+
 template <class T>
 class Memory {
  public:
@@ -2173,6 +2324,14 @@ class Memory<JsonArray> {
   }
 };
 
+template <>
+class Memory<BinaryDocument> {
+ public:
+  static uint64_t Consumption(const BinaryDocument &object) {
+    return document::Memory(object);
+  }
+};
+
 template <class K, class V>
 class Memory<Map<K, V>> {
  public:
@@ -2215,4 +2374,18 @@ class Memory<Map<K, V>> {
   }
 };
 
+template <class T>
+class Patcher {
+ public:
+  static void Patch(T &object, const T &patch) { object = patch; }
+};
+
+template <>
+class Patcher<JsonObject> {
+ public:
+  static void Patch(JsonObject &object, const JsonObject &patch) {
+    object.Patch(patch);
+  }
+};
+
 #endif
\ No newline at end of file
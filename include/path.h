@@ -0,0 +1,95 @@
+/* Copyright 2022 Jonas Hegemann <jonas.hegemann@hotmail.de>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#ifndef PATH_H
+#define PATH_H
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "json.h"
+#include "utils.h"
+
+class JsonPathStep;
+class JsonReference;
+class JsonPath;
+
+const char kJsonPathPointer = '/';
+const char kJsonPathEscape = '~';
+const std::string kJsonPathBorders = ".[";
+
+class JsonPathStep {
+ public:
+  JsonPathStep(const std::string &key, size_t index, bool keyed);
+  virtual ~JsonPathStep();
+  const std::string &GetKey() const;
+  size_t GetIndex() const;
+  bool IsKeyed() const;
+  bool IsIndexed() const;
+
+ private:
+  std::string key_;
+  size_t index_;
+  bool keyed_;
+};
+
+class JsonReference {
+ public:
+  friend class JsonPath;
+  JsonReference();
+  virtual ~JsonReference();
+  bool IsMissing() const;
+  bool IsNull() const;
+  bool IsBoolean() const;
+  bool IsInteger() const;
+  bool IsFloat() const;
+  bool IsString() const;
+  bool IsObject() const;
+  bool IsArray() const;
+  JsonBoolean GetBoolean() const;
+  JsonInteger GetInteger() const;
+  JsonFloat GetFloat() const;
+  std::string_view GetString() const;
+  const JsonObject *GetObject() const;
+  const JsonArray *GetArray() const;
+
+ private:
+  const JsonObject *object_;
+  const JsonValue *value_;
+  const JsonArray *array_;
+  size_t index_;
+  std::shared_ptr<const JsonValue> owner_;
+  void Resolve();
+};
+
+class JsonPath {
+ public:
+  JsonPath();
+  JsonPath(const std::string &path);
+  virtual ~JsonPath();
+  size_t Size() const;
+  bool IsEmpty() const;
+  JsonReference Find(const JsonObject &object) const;
+  std::string String() const;
+  void Parse(const std::string &path);
+
+ private:
+  std::vector<JsonPathStep> steps_;
+  void ParsePointer(const std::string &path);
+  void ParseDotted(const std::string &path);
+};
+
+#endif
\ No newline at end of file
@@ -15,15 +15,19 @@ limitations under the License. */
 #ifndef SERVICE_H
 #define SERVICE_H
 
+#include <sys/wait.h>
+
 #include <atomic>
 #include <fstream>
 #include <optional>
 #include <thread>
 
+#include "cache.h"
 #include "journal.h"
 #include "json.h"
 #include "map.h"
 #include "rand.h"
+#include "snapshot.h"
 #include "trace.h"
 #include "utils.h"
 
@@ -35,18 +39,34 @@ const std::string kServiceSuffixJournal = ".journal";
 const std::string kServiceSuffixSnapshot = ".snapshot";
 const std::string kServiceSuffixClosed = ".closed";
 const std::string kServiceSuffixCorrupted = ".corrupted";
+const std::string kCheckpointMerge = "merge";
+const std::string kCheckpointFork = "fork";
+
+enum DatabaseCheckpoint { CHECKPOINT_MERGE = 0, CHECKPOINT_FORK };
 
 typedef Map<std::string, JsonObject> Database;
 typedef Serializer<Database> DatabaseSerializer;
 typedef Memory<Database> DatabaseMemory;
 typedef Journal<std::string, JsonObject> DatabaseJournal;
+typedef DatabaseJournal::Delta DatabaseDelta;
+typedef SnapshotWriter<std::string, JsonObject> DatabaseSnapshotWriter;
+typedef SnapshotReader<std::string, JsonObject> DatabaseSnapshotReader;
+typedef SnapshotLoader<std::string, JsonObject> DatabaseSnapshotLoader;
+typedef Cache<std::string, std::string> DatabaseCache;
 
 namespace db {
 
 size_t Serialize(const std::string &filepath, const Database &database,
+                 CompressionCodec codec = COMPRESSION_NONE,
                  const std::atomic<bool> &cancel = false);
 size_t Deserialize(const std::string &filepath, Database &database,
                    const std::atomic<bool> &cancel = false);
+size_t Replay(const std::string &filepath, Database &database,
+              const std::atomic<bool> &cancel = false);
+size_t Merge(const std::string &filepath, const std::string &target,
+             DatabaseDelta &delta, JsonStringPool *pool = nullptr,
+             CompressionCodec codec = COMPRESSION_NONE,
+             const std::atomic<bool> &cancel = false);
 
 }  // namespace db
 
@@ -56,31 +76,57 @@ class ApiService {
   virtual ~ApiService();
   virtual void Initialize() = 0;
   virtual void Tick() = 0;
+  virtual uint64_t Commit() = 0;
+  virtual uint64_t GetCommitted() const = 0;
+  virtual int GetNotifier() const = 0;
   virtual void Shutdown() = 0;
 };
 
 class DocumentDatabase : public ApiService {
  public:
-  DocumentDatabase(const std::string &filepath);
+  DocumentDatabase(const std::string &filepath, uint64_t cache_capacity = 0,
+                   bool string_pool = false,
+                   DatabaseDurability durability = DURABILITY_FLUSH,
+                   DatabaseCheckpoint checkpoint = CHECKPOINT_MERGE,
+                   bool lazy_loading = false,
+                   CompressionCodec compression = COMPRESSION_NONE);
   virtual ~DocumentDatabase();
   virtual void Initialize();
   virtual void Tick();
+  virtual uint64_t Commit();
+  virtual uint64_t GetCommitted() const;
+  virtual int GetNotifier() const;
   virtual void Shutdown();
   JsonArray Insert(const JsonArray &values);
   JsonObject Update(const JsonObject &values);
+  JsonObject Patch(const JsonObject &patches);
   JsonArray Erase(const JsonArray &keys);
-  JsonArray Find(const JsonArray &keys) const;
+  std::string FindString(const JsonArray &keys);
 
  private:
+  void OpenJournal();
+  void CloseJournal();
   void RotateJournal();
   void Rollover();
+  void LoadEagerly();
+  bool LoadLazily();
+  void ForkCheckpoint();
+  bool ReapCheckpoint(bool block);
   std::string filepath_;
   std::string filepath_journal_;
   std::string filepath_closed_;
   std::string filepath_snapshot_;
   std::string filepath_corrupted_;
-  std::ofstream stream_journal_;
+  JournalWriter journal_;
+  DatabaseDurability durability_;
+  DatabaseCheckpoint checkpoint_;
+  pid_t checkpoint_process_;
+  bool lazy_loading_;
+  CompressionCodec compression_;
+  DatabaseSnapshotLoader loader_;
+  std::unique_ptr<JsonStringPool> string_pool_;
   Database database_;
+  DatabaseCache cache_;
   Random random_;
   std::thread rollover_worker_;
   std::atomic<bool> rollover_in_progress_;
@@ -93,6 +139,9 @@ class UserPool : public ApiService {
   virtual ~UserPool();
   virtual void Initialize();
   virtual void Tick();
+  virtual uint64_t Commit();
+  virtual uint64_t GetCommitted() const;
+  virtual int GetNotifier() const;
   virtual void Shutdown();
   bool AccessPermitted(const std::string &user,
                        const std::string &password) const;
@@ -0,0 +1,536 @@
+/* Copyright 2022 Jonas Hegemann <jonas.hegemann@hotmail.de>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "compression.h"
+#include "encoding.h"
+#include "map.h"
+
+const size_t kSnapshotPageSize = 65536;
+const size_t kSnapshotFooterSize = sizeof(uint64_t);
+
+template <class K, class V>
+class SnapshotWriter {
+ public:
+  SnapshotWriter();
+  virtual ~SnapshotWriter();
+  bool Open(const std::string &filepath,
+            CompressionCodec codec = COMPRESSION_NONE);
+  bool Add(const K &key, const V &value);
+  size_t Close();
+
+ private:
+  bool FlushPage();
+  std::ofstream stream_;
+  std::ostringstream page_;
+  std::string block_;
+  CompressionCodec codec_;
+  EncodingDictionary dictionary_;
+  std::vector<K> keys_;
+  std::vector<uint64_t> offsets_;
+  std::vector<uint64_t> lengths_;
+  std::vector<uint64_t> sizes_;
+  std::vector<uint64_t> counts_;
+  std::vector<uint32_t> checksums_;
+  K first_;
+  size_t count_;
+};
+
+template <class K, class V>
+class SnapshotReader {
+ public:
+  SnapshotReader();
+  virtual ~SnapshotReader();
+  bool Open(const std::string &filepath, int advice = MADV_SEQUENTIAL);
+  void Close();
+  bool IsOpen() const;
+  bool IsPaged() const;
+  uint8_t GetFlags() const;
+  CompressionCodec GetCodec() const;
+  EncodingReader &GetReader();
+  size_t Pages() const;
+  size_t Size() const;
+  size_t Locate(const K &key) const;
+  bool Load(size_t page, std::vector<std::pair<K, V>> &entries) const;
+  bool Load(std::vector<std::vector<std::pair<K, V>>> &pages, size_t threads,
+            const std::atomic<bool> &cancel = false) const;
+
+ private:
+  MappedFile file_;
+  EncodingReader reader_;
+  uint8_t flags_;
+  CompressionCodec codec_;
+  std::vector<K> keys_;
+  std::vector<uint64_t> offsets_;
+  std::vector<uint64_t> lengths_;
+  std::vector<uint64_t> sizes_;
+  std::vector<uint64_t> counts_;
+  std::vector<uint32_t> checksums_;
+  size_t size_;
+};
+
+template <class K, class V>
+class SnapshotLoader {
+ public:
+  SnapshotLoader();
+  virtual ~SnapshotLoader();
+  bool Open(const std::string &filepath, Map<K, V> &db,
+            const std::function<void(V &value)> &prepare);
+  void Close();
+  bool IsLoading() const;
+  size_t Pages() const;
+  size_t Remaining() const;
+  void Fault(const K &key);
+  void Install();
+  void Finish();
+
+ private:
+  void Warm();
+  void Insert(size_t page, std::vector<std::pair<K, V>> &entries);
+  SnapshotReader<K, V> reader_;
+  Map<K, V> *db_;
+  std::function<void(V &value)> prepare_;
+  std::vector<bool> loaded_;
+  size_t remaining_;
+  std::thread worker_;
+  std::mutex mutex_;
+  std::deque<std::pair<std::pair<size_t, bool>, std::vector<std::pair<K, V>>>>
+      ready_;
+  std::atomic<size_t> available_;
+  std::atomic<bool> stop_;
+};
+
+template <class K, class V>
+SnapshotWriter<K, V>::SnapshotWriter()
+    : codec_(COMPRESSION_NONE), count_(0) {}
+
+template <class K, class V>
+SnapshotWriter<K, V>::~SnapshotWriter() {}
+
+template <class K, class V>
+bool SnapshotWriter<K, V>::Open(const std::string &filepath,
+                                CompressionCodec codec) {
+  uint8_t flags = kEncodingFlagPaged;
+  if (codec != COMPRESSION_NONE) {
+    flags |= kEncodingFlagCompressed;
+  }
+  codec_ = codec;
+  remove(filepath.c_str());
+  stream_.open(filepath, std::fstream::binary);
+  if (encoding::WriteHeader(stream_, flags, codec) == std::string::npos) {
+    return false;
+  }
+  encoding::SetVersion(page_, kEncodingVersion2);
+  encoding::SetDictionary(page_, &dictionary_);
+  return true;
+}
+
+template <class K, class V>
+bool SnapshotWriter<K, V>::Add(const K &key, const V &value) {
+  if (count_ == 0) {
+    first_ = key;
+  }
+  if (Serializer<K>::Serialize(key, page_) == std::string::npos ||
+      Serializer<V>::Serialize(value, page_) == std::string::npos) {
+    return false;
+  }
+  count_++;
+  if ((size_t)page_.tellp() >= kSnapshotPageSize) {
+    return FlushPage();
+  }
+  return true;
+}
+
+template <class K, class V>
+size_t SnapshotWriter<K, V>::Close() {
+  if (!FlushPage()) {
+    return std::string::npos;
+  }
+  uint64_t index = stream_.tellp();
+  encoding::WriteLength(stream_, keys_.size());
+  for (size_t i = 0; i < keys_.size(); i++) {
+    Serializer<K>::Serialize(keys_[i], stream_);
+    encoding::WriteVarint(stream_, offsets_[i]);
+    encoding::WriteVarint(stream_, lengths_[i]);
+    encoding::WriteVarint(stream_, sizes_[i]);
+    encoding::WriteVarint(stream_, counts_[i]);
+    encoding::WriteVarint(stream_, checksums_[i]);
+  }
+  stream_.write((const char *)&index, kSnapshotFooterSize);
+  size_t bytes = stream_.tellp();
+  stream_.close();
+  return stream_ ? bytes : std::string::npos;
+}
+
+template <class K, class V>
+bool SnapshotWriter<K, V>::FlushPage() {
+  if (count_ == 0) {
+    return true;
+  }
+  std::string data = std::move(page_).str();
+  if (data.length() > kCompressionBlockMaximum) {
+    return false;
+  }
+  sizes_.push_back(data.length());
+  if (codec_ != COMPRESSION_NONE) {
+    block_.clear();
+    compression::Compress(codec_, data.data(), data.length(), block_);
+    data.swap(block_);
+  }
+  keys_.push_back(first_);
+  offsets_.push_back(stream_.tellp());
+  lengths_.push_back(data.length());
+  counts_.push_back(count_);
+  checksums_.push_back(encoding::Crc32c(data.data(), data.length()));
+  stream_.write(data.data(), data.length());
+  data.clear();
+  page_.str(std::move(data));
+  dictionary_.Clear();
+  count_ = 0;
+  return (bool)stream_;
+}
+
+template <class K, class V>
+SnapshotReader<K, V>::SnapshotReader()
+    : reader_(nullptr, 0), flags_(0), codec_(COMPRESSION_NONE), size_(0) {}
+
+template <class K, class V>
+SnapshotReader<K, V>::~SnapshotReader() {}
+
+template <class K, class V>
+bool SnapshotReader<K, V>::Open(const std::string &filepath, int advice) {
+  Close();
+  if (!file_.Open(filepath, advice)) {
+    return false;
+  }
+  reader_ = EncodingReader(file_.GetData(), file_.Size());
+  uint8_t codec;
+  if (encoding::ReadHeader(reader_, flags_, codec) == std::string::npos ||
+      codec > COMPRESSION_LZ) {
+    Close();
+    return false;
+  }
+  codec_ = (CompressionCodec)codec;
+  if (!IsPaged()) {
+    return true;
+  }
+  uint64_t offset;
+  if (file_.Size() < reader_.Offset() + kSnapshotFooterSize) {
+    Close();
+    return false;
+  }
+  memcpy(&offset, file_.GetData() + file_.Size() - kSnapshotFooterSize,
+         kSnapshotFooterSize);
+  if (offset < reader_.Offset() ||
+      offset > file_.Size() - kSnapshotFooterSize) {
+    Close();
+    return false;
+  }
+  EncodingReader index(file_.GetData() + offset,
+                       file_.Size() - kSnapshotFooterSize - offset);
+  index.SetVersion(kEncodingVersion2);
+  size_t pages;
+  if (encoding::ReadLength(index, pages) == std::string::npos) {
+    Close();
+    return false;
+  }
+  K key;
+  uint64_t values[5];
+  for (size_t i = 0; i < pages; i++) {
+    if (Serializer<K>::Deserialize(key, index) == std::string::npos ||
+        encoding::ReadVarint(index, values[0]) == std::string::npos ||
+        encoding::ReadVarint(index, values[1]) == std::string::npos ||
+        encoding::ReadVarint(index, values[2]) == std::string::npos ||
+        encoding::ReadVarint(index, values[3]) == std::string::npos ||
+        encoding::ReadVarint(index, values[4]) == std::string::npos ||
+        values[0] + values[1] > offset ||
+        values[2] > kCompressionBlockMaximum ||
+        (codec_ == COMPRESSION_NONE && values[1] != values[2]) ||
+        values[4] > UINT32_MAX) {
+      Close();
+      return false;
+    }
+    keys_.push_back(key);
+    offsets_.push_back(values[0]);
+    lengths_.push_back(values[1]);
+    sizes_.push_back(values[2]);
+    counts_.push_back(values[3]);
+    checksums_.push_back(values[4]);
+    size_ += values[3];
+  }
+  return true;
+}
+
+template <class K, class V>
+void SnapshotReader<K, V>::Close() {
+  file_.Close();
+  reader_ = EncodingReader(nullptr, 0);
+  flags_ = 0;
+  codec_ = COMPRESSION_NONE;
+  keys_.clear();
+  offsets_.clear();
+  lengths_.clear();
+  sizes_.clear();
+  counts_.clear();
+  checksums_.clear();
+  size_ = 0;
+}
+
+template <class K, class V>
+inline bool SnapshotReader<K, V>::IsOpen() const {
+  return file_.GetData() != nullptr;
+}
+
+template <class K, class V>
+inline bool SnapshotReader<K, V>::IsPaged() const {
+  return flags_ & kEncodingFlagPaged;
+}
+
+template <class K, class V>
+inline uint8_t SnapshotReader<K, V>::GetFlags() const {
+  return flags_;
+}
+
+template <class K, class V>
+inline CompressionCodec SnapshotReader<K, V>::GetCodec() const {
+  return codec_;
+}
+
+template <class K, class V>
+inline EncodingReader &SnapshotReader<K, V>::GetReader() {
+  return reader_;
+}
+
+template <class K, class V>
+inline size_t SnapshotReader<K, V>::Pages() const {
+  return keys_.size();
+}
+
+template <class K, class V>
+inline size_t SnapshotReader<K, V>::Size() const {
+  return size_;
+}
+
+template <class K, class V>
+size_t SnapshotReader<K, V>::Locate(const K &key) const {
+  auto lookup = std::upper_bound(keys_.begin(), keys_.end(), key);
+  return lookup == keys_.begin() ? 0 : lookup - keys_.begin() - 1;
+}
+
+template <class K, class V>
+bool SnapshotReader<K, V>::Load(size_t page,
+                                std::vector<std::pair<K, V>> &entries) const {
+  EncodingDictionary dictionary;
+  std::string block;
+  EncodingReader reader(file_.GetData() + offsets_[page], lengths_[page]);
+  if (encoding::Crc32c(reader.Current(), reader.Size()) != checksums_[page]) {
+    return false;
+  }
+  if (codec_ != COMPRESSION_NONE) {
+    if (!compression::Decompress(codec_, reader.Current(), reader.Size(),
+                                 block, sizes_[page]) ||
+        block.length() != sizes_[page]) {
+      return false;
+    }
+    reader = EncodingReader(block.data(), block.length());
+  }
+  reader.SetVersion(kEncodingVersion2);
+  reader.SetDictionary(&dictionary);
+  entries.resize(counts_[page]);
+  for (auto &entry : entries) {
+    if (Serializer<K>::Deserialize(entry.first, reader) == std::string::npos ||
+        Serializer<V>::Deserialize(entry.second, reader) ==
+            std::string::npos) {
+      return false;
+    }
+  }
+  return reader.Remaining() == 0;
+}
+
+template <class K, class V>
+bool SnapshotReader<K, V>::Load(
+    std::vector<std::vector<std::pair<K, V>>> &pages, size_t threads,
+    const std::atomic<bool> &cancel) const {
+  pages.clear();
+  pages.resize(keys_.size());
+  std::atomic<size_t> next(0);
+  std::atomic<bool> good(true);
+  std::vector<std::thread> workers;
+  for (size_t idx = 0; idx < std::min(threads, pages.size()); idx++) {
+    workers.emplace_back([&] {
+      for (size_t page = next++; page < pages.size() && good; page = next++) {
+        if (cancel || !Load(page, pages[page])) {
+          good = false;
+        }
+      }
+    });
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  return good;
+}
+
+template <class K, class V>
+SnapshotLoader<K, V>::SnapshotLoader()
+    : db_(nullptr), remaining_(0), available_(0), stop_(false) {}
+
+template <class K, class V>
+SnapshotLoader<K, V>::~SnapshotLoader() {
+  Close();
+}
+
+template <class K, class V>
+bool SnapshotLoader<K, V>::Open(const std::string &filepath, Map<K, V> &db,
+                                const std::function<void(V &value)> &prepare) {
+  Close();
+  if (!reader_.Open(filepath, MADV_RANDOM) || !reader_.IsPaged()) {
+    reader_.Close();
+    return false;
+  }
+  db_ = &db;
+  prepare_ = prepare;
+  loaded_.assign(reader_.Pages(), false);
+  remaining_ = reader_.Pages();
+  stop_ = false;
+  if (remaining_ == 0) {
+    Close();
+    return true;
+  }
+  worker_ = std::thread([this] { Warm(); });
+  return true;
+}
+
+template <class K, class V>
+void SnapshotLoader<K, V>::Close() {
+  if (worker_.joinable()) {
+    stop_ = true;
+    worker_.join();
+  }
+  ready_.clear();
+  available_ = 0;
+  loaded_.clear();
+  remaining_ = 0;
+  reader_.Close();
+}
+
+template <class K, class V>
+inline bool SnapshotLoader<K, V>::IsLoading() const {
+  return remaining_ > 0;
+}
+
+template <class K, class V>
+inline size_t SnapshotLoader<K, V>::Pages() const {
+  return loaded_.size();
+}
+
+template <class K, class V>
+inline size_t SnapshotLoader<K, V>::Remaining() const {
+  return remaining_;
+}
+
+template <class K, class V>
+void SnapshotLoader<K, V>::Fault(const K &key) {
+  if (remaining_ == 0) {
+    return;
+  }
+  size_t page = reader_.Locate(key);
+  if (loaded_[page]) {
+    return;
+  }
+  std::vector<std::pair<K, V>> entries;
+  if (!reader_.Load(page, entries)) {
+    throw std::runtime_error("snapshot: could not load page");
+  }
+  Insert(page, entries);
+}
+
+template <class K, class V>
+void SnapshotLoader<K, V>::Install() {
+  if (available_ == 0) {
+    return;
+  }
+  std::deque<std::pair<std::pair<size_t, bool>, std::vector<std::pair<K, V>>>>
+      ready;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ready.swap(ready_);
+    available_ = 0;
+  }
+  for (auto &page : ready) {
+    if (!page.first.second) {
+      throw std::runtime_error("snapshot: could not load page");
+    }
+    Insert(page.first.first, page.second);
+  }
+}
+
+template <class K, class V>
+void SnapshotLoader<K, V>::Finish() {
+  while (remaining_ > 0) {
+    Install();
+    for (size_t page = 0; page < loaded_.size() && remaining_ > 0; page++) {
+      if (!loaded_[page]) {
+        std::vector<std::pair<K, V>> entries;
+        if (!reader_.Load(page, entries)) {
+          throw std::runtime_error("snapshot: could not load page");
+        }
+        Insert(page, entries);
+      }
+    }
+  }
+}
+
+template <class K, class V>
+void SnapshotLoader<K, V>::Warm() {
+  for (size_t page = 0; page < loaded_.size() && !stop_; page++) {
+    std::vector<std::pair<K, V>> entries;
+    bool good = reader_.Load(page, entries);
+    std::lock_guard<std::mutex> lock(mutex_);
+    ready_.emplace_back(std::make_pair(page, good), std::move(entries));
+    available_ = ready_.size();
+  }
+}
+
+template <class K, class V>
+void SnapshotLoader<K, V>::Insert(size_t page,
+                                  std::vector<std::pair<K, V>> &entries) {
+  if (remaining_ == 0 || loaded_[page]) {
+    return;
+  }
+  for (auto &entry : entries) {
+    if (prepare_) {
+      prepare_(entry.second);
+    }
+    db_->Insert(entry.first, entry.second);
+  }
+  loaded_[page] = true;
+  if (--remaining_ == 0) {
+    Close();
+  }
+}
+
+#endif
\ No newline at end of file
@@ -75,6 +75,7 @@ const std::string kTcpLocalHost = "127.0.0.1";
 const long kTcpReceiveBufferSize = 65536L;
 const long kTcpSendBufferSize = 65536L;
 const long kTcpMaximumPayloadSize = 1073741824L;
+const long kTcpReceiveChunkSize = 1048576L;
 const long kTcpTimeout = 10000L;
 
 enum IoStatusCode {
@@ -112,7 +113,8 @@ class TcpSocket {
   bool Block();
   bool IsGood() const;
   TcpSocket *Accept();
-  IoStatusCode Receive(std::string &payload);
+  IoStatusCode Receive(std::string &payload,
+                       long limit = kTcpMaximumPayloadSize);
   IoStatusCode Send(std::string &payload);
 
  private:
@@ -140,6 +142,7 @@ class TcpReader {
   bool Peak(const std::string &token);
   std::string Tok();
   std::string Tok(size_t length);
+  void Discard();
   bool HasErrors() const;
 
  private:
@@ -50,6 +50,82 @@ static bool JsonContent(const HttpRequest &request) {
   return false;
 }
 
+InsertStream::InsertStream(DocumentDatabase *database)
+    : database_(database), failed_(false), finished_(false) {}
+
+InsertStream::~InsertStream() {
+  if (finished_) {
+    return;
+  }
+  try {
+    if (!failed_) {
+      Abort();
+    }
+    database_->Commit();
+  } catch (std::runtime_error &) {
+  }
+}
+
+void InsertStream::Consume(const std::string &chunk) {
+  if (failed_) {
+    return;
+  }
+  std::string element;
+  JsonObject object;
+  JsonArray batch;
+  JsonArray keys;
+  size_t offset;
+  try {
+    parser_.Feed(chunk);
+    while (parser_.Next(element)) {
+      if (element[0] == kCharCurlyBracketOpen) {
+        object.ParseLazy(element);
+        batch.PutObject(object);
+        continue;
+      }
+      offset = 0;
+      if (!json::Skip(element, offset)) {
+        throw std::runtime_error("api: invalid stream element");
+      }
+      batch.PutNull();
+    }
+  } catch (std::runtime_error &) {
+    Abort();
+    return;
+  }
+  if (batch.Size() == 0) {
+    return;
+  }
+  keys = database_->Insert(batch);
+  for (size_t i = 0; i < keys.Size(); i++) {
+    if (keys.IsString(i)) {
+      result_.PutString(keys.GetString(i));
+    } else {
+      result_.PutNull();
+    }
+  }
+}
+
+HttpResponse InsertStream::Finish() {
+  finished_ = true;
+  if (!failed_ && !parser_.IsComplete()) {
+    Abort();
+  }
+  if (failed_) {
+    return HttpResponse::Build(HttpStatus::BAD_REQUEST, APPLICATION_JSON,
+                               result_.String());
+  }
+  return HttpResponse::Build(HttpStatus::OK, APPLICATION_JSON,
+                             result_.String());
+}
+
+void InsertStream::Abort() {
+  failed_ = true;
+  if (result_.Size() > 0) {
+    database_->Erase(result_);
+  }
+}
+
 HttpResponse Insert(const HttpRequest &request, ServiceMap &services) {
   if (!ServicesAvailable(services)) {
     return HttpResponse::Build(HttpStatus::INTERNAL_SERVER_ERROR);
@@ -60,9 +136,9 @@ HttpResponse Insert(const HttpRequest &request, ServiceMap &services) {
   if (!JsonContent(request)) {
     return HttpResponse::Build(HttpStatus::BAD_REQUEST);
   }
-  JsonArray array;
+  JsonArray array(request.GetArena());
   try {
-    array.Parse(request.GetBody());
+    array.ParseLazy(request.GetBody());
   } catch (std::runtime_error &) {
     return HttpResponse::Build(HttpStatus::BAD_REQUEST);
   }
@@ -72,6 +148,16 @@ HttpResponse Insert(const HttpRequest &request, ServiceMap &services) {
                              db->Insert(array).String());
 }
 
+std::unique_ptr<HttpStream> StreamInsert(const HttpRequest &request,
+                                         ServiceMap &services) {
+  if (!ServicesAvailable(services) || !AccessPermitted(request, services) ||
+      !JsonContent(request)) {
+    return nullptr;
+  }
+  return std::make_unique<InsertStream>(
+      static_cast<DocumentDatabase *>(services[kServiceDatabase]));
+}
+
 HttpResponse Update(const HttpRequest &request, ServiceMap &services) {
   if (!ServicesAvailable(services)) {
     return HttpResponse::Build(HttpStatus::INTERNAL_SERVER_ERROR);
@@ -84,7 +170,7 @@ HttpResponse Update(const HttpRequest &request, ServiceMap &services) {
   }
   JsonObject object;
   try {
-    object.Parse(request.GetBody());
+    object.ParseLazy(request.GetBody());
   } catch (std::runtime_error &) {
     return HttpResponse::Build(HttpStatus::BAD_REQUEST);
   }
@@ -94,6 +180,28 @@ HttpResponse Update(const HttpRequest &request, ServiceMap &services) {
                              db->Update(object).String());
 }
 
+HttpResponse Patch(const HttpRequest &request, ServiceMap &services) {
+  if (!ServicesAvailable(services)) {
+    return HttpResponse::Build(HttpStatus::INTERNAL_SERVER_ERROR);
+  }
+  if (!AccessPermitted(request, services)) {
+    return HttpResponse::Build(HttpStatus::UNAUTHORIZED);
+  }
+  if (!JsonContent(request)) {
+    return HttpResponse::Build(HttpStatus::BAD_REQUEST);
+  }
+  JsonObject object;
+  try {
+    object.ParseLazy(request.GetBody());
+  } catch (std::runtime_error &) {
+    return HttpResponse::Build(HttpStatus::BAD_REQUEST);
+  }
+  DocumentDatabase *db =
+      static_cast<DocumentDatabase *>(services[kServiceDatabase]);
+  return HttpResponse::Build(HttpStatus::OK, APPLICATION_JSON,
+                             db->Patch(object).String());
+}
+
 HttpResponse Erase(const HttpRequest &request, ServiceMap &services) {
   if (!ServicesAvailable(services)) {
     return HttpResponse::Build(HttpStatus::INTERNAL_SERVER_ERROR);
@@ -104,7 +212,7 @@ HttpResponse Erase(const HttpRequest &request, ServiceMap &services) {
   if (!JsonContent(request)) {
     return HttpResponse::Build(HttpStatus::BAD_REQUEST);
   }
-  JsonArray array;
+  JsonArray array(request.GetArena());
   try {
     array.Parse(request.GetBody());
   } catch (std::runtime_error &) {
@@ -126,7 +234,7 @@ HttpResponse Find(const HttpRequest &request, ServiceMap &services) {
   if (!JsonContent(request)) {
     return HttpResponse::Build(HttpStatus::BAD_REQUEST);
   }
-  JsonArray array;
+  JsonArray array(request.GetArena());
   try {
     array.Parse(request.GetBody());
   } catch (std::runtime_error &) {
@@ -135,7 +243,7 @@ HttpResponse Find(const HttpRequest &request, ServiceMap &services) {
   DocumentDatabase *db =
       static_cast<DocumentDatabase *>(services[kServiceDatabase]);
   return HttpResponse::Build(HttpStatus::OK, APPLICATION_JSON,
-                             db->Find(array).String());
+                             db->FindString(array));
 }
 
 }  // namespace db_api
@@ -0,0 +1,598 @@
+/* Copyright 2022 Jonas Hegemann <jonas.hegemann@hotmail.de>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <unistd.h>
+
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <vector>
+
+#include "clock.h"
+#include "document.h"
+#include "json.h"
+#include "log.h"
+#include "map.h"
+#include "path.h"
+#include "rand.h"
+#include "service.h"
+#include "utils.h"
+
+static const char kOptionBenchmark = 'b';
+static const char kOptionDocuments = 'd';
+static const char kOptionCycles = 'c';
+static const char kOptionHelp = 'h';
+static const char *kOptionString = "hb:d:c:";
+
+static const std::string kBenchmarkNumbers = "numbers";
+static const std::string kBenchmarkPaths = "paths";
+static const std::string kBenchmarkDocuments = "documents";
+static const std::string kBenchmarkRecovery = "recovery";
+static const std::string kBenchmarkDefault = kBenchmarkNumbers;
+
+static const size_t kDocumentsDefault = 10000;
+static const size_t kCyclesDefault = 4;
+static const size_t kNumberFields = 16;
+static const size_t kNumberArrayLength = 32;
+static const size_t kRecoveryBatchSize = 100;
+static const std::string kRecoveryPath = "./data/muonbase-bench.db";
+static const std::vector<std::string> kPathExpressions = {
+    "9IKxj6Qw.lKKdJAFt", "c8EwQ9n9[2]", "/9IKxj6Qw/fsm9iOxx"};
+
+static void PrintVersion() {
+  std::cout << "Muonbase v1.0.2" << std::endl;
+  std::cout << "Copyright 2022 Jonas Hegemann <jonas.hegemann@hotmail.de>"
+            << std::endl;
+}
+
+static void PrintUsage() {
+  std::cout << "Usage: muonbase-bench [-h] [-b <benchmark>] [-d <documents>] "
+               "[-c <cycles>]"
+            << std::endl;
+  std::cout << "\t -h: help" << std::endl;
+  std::cout << "\t -b <benchmark>: " << kBenchmarkNumbers << ", "
+            << kBenchmarkPaths << ", " << kBenchmarkDocuments << ", "
+            << kBenchmarkRecovery << " - default " << kBenchmarkDefault
+            << std::endl;
+  std::cout << "\t -d <documents>: documents - default " << kDocumentsDefault
+            << std::endl;
+  std::cout << "\t -c <cycles>: cycles - default " << kCyclesDefault
+            << std::endl;
+}
+
+static std::string NumberKey(char prefix, size_t index) {
+  std::string key(1, prefix);
+  key.append(std::to_string(index));
+  return key;
+}
+
+static JsonInteger RandomInteger(Random &random) {
+  return (JsonInteger)random.UniformInteger() >> (random.UniformInteger() % 64);
+}
+
+static JsonFloat RandomFloat(Random &random) {
+  return (random.UniformDouble() - 0.5) * 2.0e6;
+}
+
+static JsonObject RandomNumberObject(Random &random) {
+  JsonObject object;
+  for (size_t i = 0; i < kNumberFields; i++) {
+    object.PutInteger(NumberKey('i', i), RandomInteger(random));
+    object.PutFloat(NumberKey('f', i), RandomFloat(random));
+  }
+  JsonArray array;
+  for (size_t i = 0; i < kNumberArrayLength; i++) {
+    if (i % 2 == 0) {
+      array.PutInteger(RandomInteger(random));
+    } else {
+      array.PutFloat(RandomFloat(random));
+    }
+  }
+  object.PutArray("a", array);
+  return object;
+}
+
+static void BenchmarkNumbers(size_t documents, size_t cycles) {
+  Random random(documents);
+  std::vector<JsonObject> objects;
+  std::vector<std::string> sources;
+  size_t bytes = 0;
+  for (size_t i = 0; i < documents; i++) {
+    objects.emplace_back(RandomNumberObject(random));
+    sources.emplace_back(objects.back().String());
+    bytes += sources.back().length();
+  }
+  size_t mismatches = 0;
+  for (size_t i = 0; i < documents; i++) {
+    JsonObject object(sources[i]);
+    for (size_t j = 0; j < kNumberFields; j++) {
+      std::string key = NumberKey('i', j);
+      if (!object.IsInteger(key) ||
+          object.GetInteger(key) != objects[i].GetInteger(key)) {
+        mismatches++;
+      }
+    }
+  }
+  LOG_INFO("numbers: " + std::to_string(mismatches) + " of " +
+           std::to_string(documents * kNumberFields) +
+           " integers did not round trip");
+  Clock clock;
+  JsonObject object;
+  for (size_t cycle = 0; cycle < cycles; cycle++) {
+    clock.Start();
+    for (size_t i = 0; i < documents; i++) {
+      object.Parse(sources[i]);
+    }
+    clock.Stop();
+    double seconds = clock.Time() / 1000.0;
+    LOG_INFO("numbers: cycle " + std::to_string(cycle) + " parsed " +
+             std::to_string(bytes / seconds / 1024.0 / 1024.0) +
+             " megabytes per second, " +
+             std::to_string(seconds * 1.0e9 / documents /
+                            (2 * kNumberFields + kNumberArrayLength)) +
+             " nanoseconds per number");
+  }
+}
+
+static void BenchmarkPaths(size_t documents, size_t cycles) {
+  Random random(documents);
+  Map<std::string, JsonObject> eager;
+  Map<std::string, JsonObject> lazy;
+  JsonObject object;
+  for (size_t i = 0; i < documents; i++) {
+    std::string key = random.Uuid();
+    object = json::RandomObject(random);
+    eager.Insert(key, object);
+    object.ParseLazy(object.String());
+    lazy.Insert(key, object);
+  }
+  std::vector<JsonPath> paths;
+  for (const std::string &expression : kPathExpressions) {
+    paths.emplace_back(expression);
+  }
+  Clock clock;
+  for (size_t cycle = 0; cycle < cycles; cycle++) {
+    for (Map<std::string, JsonObject> *database : {&eager, &lazy}) {
+      std::string mode = database == &eager ? "eager" : "lazy";
+      size_t scanned = 0;
+      clock.Start();
+      for (auto it = database->Begin(); it != database->End(); it++) {
+        scanned += it.GetValue().Size();
+      }
+      clock.Stop();
+      double scan_seconds = clock.Time() / 1000.0;
+      size_t chained = 0;
+      clock.Start();
+      for (auto it = database->Begin(); it != database->End(); it++) {
+        const JsonObject &value = it.GetValue();
+        chained += value.GetObject(kJsonKeySet[10]).IsInteger(kJsonKeySet[7]);
+        chained += value.GetArray(kJsonKeySet[11]).IsInteger(2);
+        chained += value.GetObject(kJsonKeySet[10]).IsString(kJsonKeySet[8]);
+      }
+      clock.Stop();
+      double chained_seconds = clock.Time() / 1000.0 - scan_seconds;
+      size_t compiled = 0;
+      clock.Start();
+      for (auto it = database->Begin(); it != database->End(); it++) {
+        for (const JsonPath &path : paths) {
+          JsonReference reference = path.Find(it.GetValue());
+          compiled += reference.IsInteger() || reference.IsString();
+        }
+      }
+      clock.Stop();
+      double compiled_seconds = clock.Time() / 1000.0 - scan_seconds;
+      if (chained != compiled) {
+        LOG_INFO("paths: " + std::to_string(chained) + " chained and " +
+                 std::to_string(compiled) + " compiled matches differ");
+      }
+      LOG_INFO("paths: cycle " + std::to_string(cycle) + " " + mode +
+               " scan " +
+               std::to_string(scan_seconds * 1.0e9 / documents) +
+               " nanoseconds per document, chained " +
+               std::to_string(chained_seconds * 1.0e9 / documents /
+                              paths.size()) +
+               " compiled " +
+               std::to_string(compiled_seconds * 1.0e9 / documents /
+                              paths.size()) +
+               " nanoseconds per path");
+    }
+  }
+}
+
+static void BenchmarkDocuments(size_t documents, size_t cycles) {
+  Random random(documents);
+  std::vector<JsonObject> objects;
+  std::vector<std::string> sources;
+  std::vector<std::string> encodings;
+  size_t bytes = 0;
+  size_t text_mismatches = 0;
+  size_t object_mismatches = 0;
+  size_t encoding_mismatches = 0;
+  for (size_t i = 0; i < documents; i++) {
+    objects.emplace_back(json::RandomObject(random));
+    sources.emplace_back(objects.back().String());
+    bytes += sources.back().length();
+    BinaryDocument parsed(sources.back());
+    BinaryDocument built(objects.back());
+    text_mismatches += parsed.String() != sources.back();
+    object_mismatches += built.ToObject() != objects.back();
+    std::stringstream stream;
+    BinaryDocument decoded;
+    document::Serialize(built, stream);
+    encodings.emplace_back(stream.str());
+    encoding_mismatches += document::Deserialize(decoded, stream) ==
+                               std::string::npos ||
+                           decoded != built;
+  }
+  LOG_INFO("documents: " + std::to_string(text_mismatches) + " text, " +
+           std::to_string(object_mismatches) + " object and " +
+           std::to_string(encoding_mismatches) + " encoding of " +
+           std::to_string(documents) + " documents did not round trip");
+  size_t rejected = 0;
+  for (size_t i = 0; i < documents; i++) {
+    std::string corrupted = encodings[i];
+    size_t position = sizeof(size_t) +
+                      random.UniformInteger() %
+                          (corrupted.length() - sizeof(size_t));
+    corrupted[position] ^= 1 << (random.UniformInteger() % 8);
+    std::stringstream stream(corrupted);
+    BinaryDocument decoded;
+    if (document::Deserialize(decoded, stream) == std::string::npos) {
+      rejected++;
+    } else {
+      decoded.String();
+    }
+  }
+  LOG_INFO("documents: " + std::to_string(rejected) + " of " +
+           std::to_string(documents) +
+           " corrupted encodings rejected, the rest rendered safely");
+  Clock clock;
+  BinaryDocument document;
+  for (size_t cycle = 0; cycle < cycles; cycle++) {
+    clock.Start();
+    for (size_t i = 0; i < documents; i++) {
+      document.Parse(sources[i]);
+    }
+    clock.Stop();
+    double parse_seconds = clock.Time() / 1000.0;
+    size_t rendered = 0;
+    clock.Start();
+    for (size_t i = 0; i < documents; i++) {
+      document.Parse(sources[i]);
+      rendered += document.String().length();
+    }
+    clock.Stop();
+    double render_seconds = clock.Time() / 1000.0 - parse_seconds;
+    LOG_INFO("documents: cycle " + std::to_string(cycle) + " parsed " +
+             std::to_string(bytes / parse_seconds / 1024.0 / 1024.0) +
+             " megabytes per second, rendered " +
+             std::to_string(rendered / render_seconds / 1024.0 / 1024.0) +
+             " megabytes per second");
+  }
+}
+
+typedef std::map<std::string, std::optional<JsonObject>> RecoveryMirror;
+
+static void RemoveRecoveryFiles() {
+  for (const std::string &suffix :
+       {std::string(), kServiceSuffixJournal, kServiceSuffixSnapshot,
+        kServiceSuffixClosed, kServiceSuffixCorrupted,
+        kServiceSuffixJournal + kServiceSuffixClosed}) {
+    remove((kRecoveryPath + suffix).c_str());
+  }
+}
+
+static std::unique_ptr<DocumentDatabase> OpenRecoveryDatabase(
+    CompressionCodec codec) {
+  auto database = std::make_unique<DocumentDatabase>(
+      kRecoveryPath, 0, false, DURABILITY_FLUSH, CHECKPOINT_MERGE, false,
+      codec);
+  database->Initialize();
+  return database;
+}
+
+static void WaitForCommit(DocumentDatabase &database) {
+  uint64_t ticket = database.Commit();
+  while (database.GetCommitted() < ticket) {
+    usleep(1000);
+  }
+}
+
+static void InsertRecoveryDocuments(DocumentDatabase &database, Random &random,
+                                    RecoveryMirror &mirror, size_t count) {
+  JsonArray values;
+  for (size_t i = 0; i < count; i++) {
+    values.PutObject(json::RandomObject(random));
+  }
+  JsonArray keys = database.Insert(values);
+  for (size_t i = 0; i < keys.Size(); i++) {
+    mirror[keys.GetString(i)] = values.GetObject(i);
+  }
+  WaitForCommit(database);
+}
+
+static void ChangeRecoveryDocuments(DocumentDatabase &database,
+                                    Random &random, RecoveryMirror &mirror,
+                                    size_t count) {
+  std::vector<std::string> keys;
+  for (auto &entry : mirror) {
+    if (entry.second) {
+      keys.push_back(entry.first);
+    }
+  }
+  JsonObject updates;
+  JsonArray erasures;
+  for (size_t i = 0; i < count && !keys.empty(); i++) {
+    std::string key = keys[random.UniformInteger() % keys.size()];
+    if (updates.Has(key) || !mirror[key]) {
+      continue;
+    }
+    if (i % 4 == 3) {
+      erasures.PutString(key);
+      mirror[key].reset();
+      continue;
+    }
+    JsonObject value = json::RandomObject(random);
+    updates.PutObject(key, value);
+    mirror[key] = value;
+  }
+  database.Update(updates);
+  database.Erase(erasures);
+  WaitForCommit(database);
+}
+
+static void VerifyRecoveryDocuments(DocumentDatabase &database,
+                                    const RecoveryMirror &mirror,
+                                    const std::string &phase) {
+  JsonArray keys;
+  for (auto &entry : mirror) {
+    keys.PutString(entry.first);
+  }
+  JsonArray values;
+  values.Parse(database.FindString(keys));
+  size_t index = 0;
+  for (auto &entry : mirror) {
+    if (entry.second ? !values.IsObject(index) ||
+                           values.GetObject(index).String() !=
+                               entry.second->String()
+                     : !values.IsNull(index)) {
+      throw std::runtime_error("recovery: " + phase +
+                               " differs from mirror at " + entry.first);
+    }
+    index++;
+  }
+  LOG_INFO("recovery: " + phase + " matches mirror of " +
+           std::to_string(mirror.size()) + " keys");
+}
+
+static void VerifyTornTail(size_t size, size_t cut, const std::string &phase) {
+  const std::string journal = kRecoveryPath + kServiceSuffixJournal;
+  const std::string copy = kRecoveryPath + kServiceSuffixClosed;
+  if (truncate(journal.c_str(), cut) != 0) {
+    throw std::runtime_error("recovery: could not truncate journal");
+  }
+  {
+    std::ifstream source(journal, std::ios::binary);
+    std::ofstream target(copy, std::ios::binary);
+    target << source.rdbuf();
+  }
+  Database database;
+  db::Deserialize(kRecoveryPath, database);
+  size_t bytes = db::Replay(copy, database);
+  size_t truncated = FileSize(copy);
+  remove(copy.c_str());
+  if (bytes != size || truncated != size) {
+    throw std::runtime_error("recovery: " + phase + " kept " +
+                             std::to_string(truncated) + " instead of " +
+                             std::to_string(size) + " journal bytes");
+  }
+  LOG_INFO("recovery: " + phase + " dropped " + std::to_string(cut - size) +
+           " torn bytes");
+}
+
+static void FlipFileByte(const std::string &filepath, size_t field) {
+  size_t offset;
+  {
+    MappedFile file;
+    if (!file.Open(filepath)) {
+      throw std::runtime_error("recovery: could not map " + filepath);
+    }
+    EncodingReader reader(file.GetData(), file.Size());
+    uint8_t flags;
+    uint8_t codec;
+    if (encoding::ReadHeader(reader, flags, codec) == std::string::npos) {
+      throw std::runtime_error("recovery: could not read header of " +
+                               filepath);
+    }
+    offset = reader.Offset() + field;
+  }
+  std::fstream stream(filepath,
+                      std::ios::binary | std::ios::in | std::ios::out);
+  char byte;
+  stream.seekg(offset);
+  stream.get(byte);
+  stream.seekp(offset);
+  stream.put(byte ^ 1);
+}
+
+static void VerifyCorruption(CompressionCodec codec, size_t field,
+                             const std::string &phase) {
+  const std::string journal = kRecoveryPath + kServiceSuffixJournal;
+  const std::string corrupted = kRecoveryPath + kServiceSuffixCorrupted;
+  std::unique_ptr<DocumentDatabase> database;
+  FlipFileByte(journal, field);
+  try {
+    database = OpenRecoveryDatabase(codec);
+  } catch (std::runtime_error &) {
+  }
+  if (database || FileExists(journal) || !FileExists(corrupted)) {
+    throw std::runtime_error("recovery: " + phase +
+                             " was not reported as corrupted");
+  }
+  LOG_INFO("recovery: " + phase + " reported as corrupted");
+  FlipFileByte(corrupted, field);
+  rename(corrupted.c_str(), journal.c_str());
+}
+
+static void BenchmarkRecovery(size_t documents, CompressionCodec codec) {
+  const std::string name =
+      codec == COMPRESSION_NONE ? kCompressionNone : kCompressionLz;
+  const std::string journal = kRecoveryPath + kServiceSuffixJournal;
+  const std::string closed = journal + kServiceSuffixClosed;
+  const std::string corrupted = kRecoveryPath + kServiceSuffixCorrupted;
+  Random random(documents);
+  RecoveryMirror mirror;
+  size_t size;
+  RemoveRecoveryFiles();
+
+  auto database = OpenRecoveryDatabase(codec);
+  for (size_t i = 0; i < documents; i += kRecoveryBatchSize) {
+    InsertRecoveryDocuments(*database, random, mirror, kRecoveryBatchSize);
+  }
+  ChangeRecoveryDocuments(*database, random, mirror, kRecoveryBatchSize);
+  database->Shutdown();
+  database = OpenRecoveryDatabase(codec);
+  VerifyRecoveryDocuments(*database, mirror, name + " startup rollover");
+
+  while (FileSize(journal) <= FileSize(kRecoveryPath)) {
+    ChangeRecoveryDocuments(*database, random, mirror, kRecoveryBatchSize);
+  }
+  database->Tick();
+  while (FileExists(closed)) {
+    usleep(10000);
+  }
+  database->Tick();
+  VerifyRecoveryDocuments(*database, mirror, name + " merge rollover");
+  ChangeRecoveryDocuments(*database, random, mirror, kRecoveryBatchSize);
+  database->Shutdown();
+  database = OpenRecoveryDatabase(codec);
+  VerifyRecoveryDocuments(*database, mirror, name + " merge restart");
+
+  while (FileSize(journal) <= FileSize(kRecoveryPath)) {
+    ChangeRecoveryDocuments(*database, random, mirror, kRecoveryBatchSize);
+  }
+  FlipFileByte(kRecoveryPath, 0);
+  database->Tick();
+  while (!FileExists(corrupted) && FileExists(closed)) {
+    usleep(10000);
+  }
+  if (!FileExists(corrupted) || !FileExists(closed)) {
+    throw std::runtime_error("recovery: " + name +
+                             " merge did not quarantine the snapshot");
+  }
+  LOG_INFO("recovery: " + name + " merge quarantined the snapshot");
+  FlipFileByte(corrupted, 0);
+  rename(corrupted.c_str(), kRecoveryPath.c_str());
+  while (FileExists(closed)) {
+    database->Tick();
+    usleep(10000);
+  }
+  database->Shutdown();
+  database = OpenRecoveryDatabase(codec);
+  VerifyRecoveryDocuments(*database, mirror, name + " snapshot restore");
+
+  RecoveryMirror torn = mirror;
+  ChangeRecoveryDocuments(*database, random, mirror, kRecoveryBatchSize);
+  size = FileSize(journal);
+  InsertRecoveryDocuments(*database, random, torn, kRecoveryBatchSize);
+  database->Shutdown();
+  VerifyTornTail(size, size + (FileSize(journal) - size) / 2,
+                 name + " mid-batch truncation");
+  database = OpenRecoveryDatabase(codec);
+  VerifyRecoveryDocuments(*database, mirror, name + " mid-batch restart");
+
+  torn = mirror;
+  ChangeRecoveryDocuments(*database, random, mirror, kRecoveryBatchSize);
+  size = FileSize(journal);
+  InsertRecoveryDocuments(*database, random, torn, 1);
+  database->Shutdown();
+  VerifyTornTail(size, FileSize(journal) - sizeof(uint32_t),
+                 name + " mid-frame truncation");
+  database = OpenRecoveryDatabase(codec);
+  VerifyRecoveryDocuments(*database, mirror, name + " mid-frame restart");
+
+  ChangeRecoveryDocuments(*database, random, mirror, kRecoveryBatchSize);
+  ChangeRecoveryDocuments(*database, random, mirror, kRecoveryBatchSize);
+  database->Shutdown();
+  database.reset();
+  VerifyCorruption(codec, sizeof(uint32_t), name + " checksum flip");
+  VerifyCorruption(codec, sizeof(uint32_t) - 1, name + " length flip");
+  database = OpenRecoveryDatabase(codec);
+  VerifyRecoveryDocuments(*database, mirror, name + " corruption restore");
+  database->Shutdown();
+  RemoveRecoveryFiles();
+}
+
+static void BenchmarkRecovery(size_t documents) {
+  try {
+    BenchmarkRecovery(documents, COMPRESSION_NONE);
+    BenchmarkRecovery(documents, COMPRESSION_LZ);
+  } catch (std::runtime_error &e) {
+    LOG_INFO(std::string(e.what()));
+    RemoveRecoveryFiles();
+    exit(1);
+  }
+}
+
+int main(int argc, char **argv) {
+  PrintVersion();
+  int option;
+  std::string benchmark = kBenchmarkDefault;
+  size_t documents = kDocumentsDefault;
+  size_t cycles = kCyclesDefault;
+  while ((option = getopt(argc, argv, kOptionString)) != -1) {
+    switch (option) {
+      case kOptionBenchmark:
+        benchmark = optarg;
+        break;
+      case kOptionDocuments:
+        documents = std::atoi(optarg);
+        break;
+      case kOptionCycles:
+        cycles = std::atoi(optarg);
+        break;
+      case kOptionHelp:
+        PrintUsage();
+        exit(0);
+      case kCharColon:
+        LOG_INFO("option needs a value");
+        PrintUsage();
+        exit(1);
+      case kCharQuestionMark:
+        LOG_INFO("unknown option " + std::string(optopt, 1));
+        PrintUsage();
+        exit(1);
+      default:
+        PrintUsage();
+        exit(0);
+    }
+  }
+
+  Log::GetInstance()->SetVerbose(true);
+
+  if (benchmark == kBenchmarkNumbers) {
+    BenchmarkNumbers(documents, cycles);
+  } else if (benchmark == kBenchmarkPaths) {
+    BenchmarkPaths(documents, cycles);
+  } else if (benchmark == kBenchmarkDocuments) {
+    BenchmarkDocuments(documents, cycles);
+  } else if (benchmark == kBenchmarkRecovery) {
+    BenchmarkRecovery(documents);
+  } else {
+    PrintUsage();
+    exit(1);
+  }
+
+  return 0;
+}
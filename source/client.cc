@@ -76,6 +76,34 @@ JsonObject Client::Update(const JsonObject &values) {
   return object;
 }
 
+JsonObject Client::Patch(const JsonObject &patches) {
+  auto response =
+      http::SendRequest(ip_, port_, POST, db_api::kRoutePatch, user_,
+                        password_, APPLICATION_JSON, patches.String());
+  if (!response) {
+    LOG_INFO("failed: patch request");
+    throw std::runtime_error("patch request");
+  }
+  if (response->GetStatus() != HttpStatus::OK) {
+    LOG_INFO("failed: patch response status");
+    LOG_INFO((*response).String());
+    throw std::runtime_error("patch request");
+  }
+  if (response->GetBody().empty()) {
+    LOG_INFO("failed: empty body");
+    LOG_INFO((*response).String());
+    throw std::runtime_error("patch request");
+  }
+  JsonObject object;
+  try {
+    object.Parse((*response).GetBody());
+  } catch (std::runtime_error &e) {
+    LOG_INFO((*response).GetBody());
+    LOG_INFO(std::string(e.what()));
+  }
+  return object;
+}
+
 JsonArray Client::Erase(const JsonArray &keys) {
   auto response =
       http::SendRequest(ip_, port_, POST, db_api::kRouteErase, user_, password_,
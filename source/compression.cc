@@ -0,0 +1,192 @@
+/* Copyright 2022 Jonas Hegemann <jonas.hegemann@hotmail.de>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "compression.h"
+
+static inline uint32_t Load(const char *data) {
+  uint32_t value;
+  memcpy(&value, data, sizeof(uint32_t));
+  return value;
+}
+
+static inline size_t Hash(uint32_t value) {
+  return (value * 2654435761u) >> (32 - kCompressionHashBits);
+}
+
+static void WriteLength(std::string &output, size_t length) {
+  for (; length >= 0xff; length -= 0xff) {
+    output.push_back((char)0xff);
+  }
+  output.push_back((char)length);
+}
+
+static bool ReadLength(const uint8_t *&input, const uint8_t *end,
+                       size_t &length) {
+  uint8_t byte;
+  do {
+    if (input == end) {
+      return false;
+    }
+    byte = *input++;
+    length += byte;
+  } while (byte == 0xff);
+  return true;
+}
+
+static void WriteSequence(std::string &output, const char *literals,
+                          size_t literal_length, size_t offset,
+                          size_t match_length) {
+  uint8_t token = std::min<size_t>(literal_length, 15) << 4;
+  if (match_length > 0) {
+    token |= std::min<size_t>(match_length - kCompressionMinimumMatch, 15);
+  }
+  output.push_back((char)token);
+  if (literal_length >= 15) {
+    WriteLength(output, literal_length - 15);
+  }
+  output.append(literals, literal_length);
+  if (match_length == 0) {
+    return;
+  }
+  output.push_back((char)(offset & 0xff));
+  output.push_back((char)(offset >> 8));
+  if (match_length - kCompressionMinimumMatch >= 15) {
+    WriteLength(output, match_length - kCompressionMinimumMatch - 15);
+  }
+}
+
+static void CompressLz(const char *data, size_t length, std::string &output) {
+  uint32_t table[1 << kCompressionHashBits] = {0};
+  size_t anchor = 0;
+  size_t position = 0;
+  size_t limit = length > kCompressionEndLiterals + kCompressionMinimumMatch
+                     ? length - kCompressionEndLiterals
+                     : 0;
+  while (position + kCompressionMinimumMatch <= limit) {
+    uint32_t sequence = Load(data + position);
+    size_t slot = Hash(sequence);
+    size_t candidate = table[slot];
+    table[slot] = position;
+    if (candidate >= position ||
+        position - candidate > kCompressionMaximumOffset ||
+        Load(data + candidate) != sequence) {
+      position += 1 + ((position - anchor) >> 6);
+      continue;
+    }
+    size_t match = kCompressionMinimumMatch;
+    while (position + match < limit &&
+           data[candidate + match] == data[position + match]) {
+      match++;
+    }
+    WriteSequence(output, data + anchor, position - anchor,
+                  position - candidate, match);
+    position += match;
+    anchor = position;
+    if (position + kCompressionMinimumMatch <= limit) {
+      table[Hash(Load(data + position - 2))] = position - 2;
+    }
+  }
+  WriteSequence(output, data + anchor, length - anchor, 0, 0);
+}
+
+static bool DecompressLz(const char *data, size_t length, char *output,
+                         size_t size) {
+  const uint8_t *input = (const uint8_t *)data;
+  const uint8_t *end = input + length;
+  size_t written = 0;
+  while (input < end) {
+    uint8_t token = *input++;
+    size_t literals = token >> 4;
+    if (literals == 15 && !ReadLength(input, end, literals)) {
+      return false;
+    }
+    if ((size_t)(end - input) < literals || size - written < literals) {
+      return false;
+    }
+    memcpy(output + written, input, literals);
+    input += literals;
+    written += literals;
+    if (input == end) {
+      break;
+    }
+    if (end - input < 2) {
+      return false;
+    }
+    size_t offset = input[0] | (input[1] << 8);
+    input += 2;
+    size_t match = token & 15;
+    if (match == 15 && !ReadLength(input, end, match)) {
+      return false;
+    }
+    match += kCompressionMinimumMatch;
+    if (offset == 0 || offset > written || size - written < match) {
+      return false;
+    }
+    char *destination = output + written;
+    const char *source = destination - offset;
+    if (offset >= match) {
+      memcpy(destination, source, match);
+    } else {
+      for (size_t idx = 0; idx < match; idx++) {
+        destination[idx] = source[idx];
+      }
+    }
+    written += match;
+  }
+  return written == size;
+}
+
+namespace compression {
+
+void Compress(CompressionCodec codec, const char *data, size_t length,
+              std::string &output) {
+  if (length > kCompressionBlockMaximum) {
+    throw std::runtime_error("compression: block too large");
+  }
+  uint64_t value = length;
+  while (value >= 0x80) {
+    output.push_back((char)(value | 0x80));
+    value >>= 7;
+  }
+  output.push_back((char)value);
+  switch (codec) {
+    case COMPRESSION_LZ:
+      CompressLz(data, length, output);
+      break;
+    default:
+      throw std::runtime_error("compression: unknown codec");
+  }
+}
+
+bool Decompress(CompressionCodec codec, const char *data, size_t length,
+                std::string &output, size_t limit) {
+  EncodingReader reader(data, length);
+  uint64_t size;
+  if (encoding::ReadVarint(reader, size) == std::string::npos ||
+      size > std::min<uint64_t>(limit, kCompressionBlockMaximum) ||
+      size > reader.Remaining() * kCompressionExpansionMaximum) {
+    return false;
+  }
+  size_t offset = output.length();
+  output.resize(offset + size);
+  switch (codec) {
+    case COMPRESSION_LZ:
+      return DecompressLz(reader.Current(), reader.Remaining(),
+                          &output[offset], size);
+    default:
+      return false;
+  }
+}
+
+}  // namespace compression
@@ -0,0 +1,763 @@
+/* Copyright 2022 Jonas Hegemann <jonas.hegemann@hotmail.de>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "document.h"
+
+namespace document {
+
+template <class T>
+static inline T Read(const std::string &bytes, size_t position) {
+  T value;
+  memcpy(&value, &bytes[position], sizeof(T));
+  return value;
+}
+
+template <class T>
+static inline void Write(std::string &bytes, size_t position, T value) {
+  memcpy(&bytes[position], &value, sizeof(T));
+}
+
+template <class T>
+static inline void Append(std::string &bytes, T value) {
+  bytes.append((const char *)&value, sizeof(T));
+}
+
+static void AppendString(std::string &bytes, const std::string &value) {
+  Append<BinaryOffset>(bytes, value.length());
+  bytes.append(value);
+}
+
+static size_t ValueSize(const std::string &bytes, size_t position) {
+  switch ((uint8_t)bytes[position]) {
+    case kJsonTypeNull:
+      return sizeof(uint8_t);
+    case kJsonTypeBoolean:
+      return sizeof(uint8_t) + sizeof(uint8_t);
+    case kJsonTypeInteger:
+      return sizeof(uint8_t) + sizeof(JsonInteger);
+    case kJsonTypeFloat:
+      return sizeof(uint8_t) + sizeof(JsonFloat);
+    case kJsonTypeString:
+      return sizeof(uint8_t) + sizeof(BinaryOffset) +
+             Read<BinaryOffset>(bytes, position + sizeof(uint8_t));
+    case kJsonTypeObject:
+      [[fallthrough]];
+    case kJsonTypeArray:
+      return Read<BinaryOffset>(bytes, position + sizeof(uint8_t));
+    default:
+      throw std::runtime_error("document: invalid type");
+  }
+}
+
+static inline size_t CountAt(const std::string &bytes, size_t position) {
+  return Read<BinaryOffset>(bytes,
+                            position + sizeof(uint8_t) + sizeof(BinaryOffset));
+}
+
+static inline size_t EntryAt(const std::string &bytes, size_t position,
+                             size_t index) {
+  return position + Read<BinaryOffset>(bytes, position + kBinaryHeaderSize +
+                                                  index * sizeof(BinaryOffset));
+}
+
+static void BeginContainer(std::string &bytes, uint8_t type, size_t count) {
+  Append<uint8_t>(bytes, type);
+  Append<BinaryOffset>(bytes, 0);
+  Append<BinaryOffset>(bytes, count);
+  bytes.append(count * sizeof(BinaryOffset), kCharNullTerminator);
+}
+
+static void FinishContainer(std::string &bytes, size_t position,
+                            const std::vector<size_t> &offsets,
+                            const std::string &body) {
+  const size_t table = position + kBinaryHeaderSize;
+  const size_t base = table + offsets.size() * sizeof(BinaryOffset);
+  for (size_t i = 0; i < offsets.size(); i++) {
+    Write<BinaryOffset>(bytes, table + i * sizeof(BinaryOffset),
+                        base - position + offsets[i]);
+  }
+  bytes.append(body);
+  Write<BinaryOffset>(bytes, position + sizeof(uint8_t),
+                      bytes.length() - position);
+}
+
+static void EncodeText(const std::string &source, size_t &offset,
+                       std::string &bytes);
+
+static void EncodeTextLiteral(const std::string &source, size_t &offset,
+                              const std::string &literal,
+                              const std::string &border) {
+  if (source.compare(offset, literal.length(), literal) != 0) {
+    throw std::runtime_error("document: parse literal value");
+  }
+  if (!CharIsAnyOf(source[offset + literal.length()], border)) {
+    throw std::runtime_error("document: parse literal value");
+  }
+  offset += literal.length();
+}
+
+static void EncodeTextNumber(const std::string &source, size_t &offset,
+                             const std::string &border, std::string &bytes) {
+  JsonNumber number;
+  if (!json::ParseNumber(source, offset, number) ||
+      offset == source.length() || !CharIsAnyOf(source[offset], border)) {
+    throw std::runtime_error("document: parse number value");
+  }
+  if (std::holds_alternative<JsonInteger>(number)) {
+    Append<uint8_t>(bytes, kJsonTypeInteger);
+    Append<JsonInteger>(bytes, std::get<JsonInteger>(number));
+  } else {
+    Append<uint8_t>(bytes, kJsonTypeFloat);
+    Append<JsonFloat>(bytes, std::get<JsonFloat>(number));
+  }
+}
+
+static void EncodeTextValue(const std::string &source, size_t &offset,
+                            const std::string &border, std::string &bytes) {
+  size_t position;
+  if (!StringExpect(source, kStringEmpty, offset)) {
+    throw std::runtime_error("document: value start");
+  }
+  switch (source[offset]) {
+    case kCharN:
+      EncodeTextLiteral(source, offset, kJsonNull, border);
+      Append<uint8_t>(bytes, kJsonTypeNull);
+      break;
+    case kCharT:
+      EncodeTextLiteral(source, offset, kJsonTrue, border);
+      Append<uint8_t>(bytes, kJsonTypeBoolean);
+      Append<uint8_t>(bytes, true);
+      break;
+    case kCharF:
+      EncodeTextLiteral(source, offset, kJsonFalse, border);
+      Append<uint8_t>(bytes, kJsonTypeBoolean);
+      Append<uint8_t>(bytes, false);
+      break;
+    case kCharDoubleQuote:
+      position = source.find(kStringDoubleQuote, offset + 1);
+      if (position == std::string::npos) {
+        throw std::runtime_error("document: parse string value");
+      }
+      Append<uint8_t>(bytes, kJsonTypeString);
+      AppendString(bytes, source.substr(offset + 1, position - offset - 1));
+      offset = position + 1;
+      break;
+    case kCharZero:
+      [[fallthrough]];
+    case kCharOne:
+      [[fallthrough]];
+    case kCharTwo:
+      [[fallthrough]];
+    case kCharThree:
+      [[fallthrough]];
+    case kCharFour:
+      [[fallthrough]];
+    case kCharFive:
+      [[fallthrough]];
+    case kCharSix:
+      [[fallthrough]];
+    case kCharSeven:
+      [[fallthrough]];
+    case kCharEight:
+      [[fallthrough]];
+    case kCharNine:
+      [[fallthrough]];
+    case kCharPlus:
+      [[fallthrough]];
+    case kCharMinus:
+      EncodeTextNumber(source, offset, border, bytes);
+      break;
+    case kCharCurlyBracketOpen:
+      [[fallthrough]];
+    case kCharSquareBracketOpen:
+      EncodeText(source, offset, bytes);
+      break;
+    default:
+      throw std::runtime_error("document: invalid value");
+  }
+}
+
+static void EncodeText(const std::string &source, size_t &offset,
+                       std::string &bytes) {
+  if (!StringExpect(source, kStringEmpty, offset)) {
+    throw std::runtime_error("document: value start");
+  }
+  const bool object = source[offset] == kCharCurlyBracketOpen;
+  if (!object && source[offset] != kCharSquareBracketOpen) {
+    throw std::runtime_error("document: initial bracket");
+  }
+  const char close =
+      object ? kCharCurlyBracketClose : kCharSquareBracketClose;
+  const std::string border = kStringWss + kStringComma + close;
+  offset++;
+  std::vector<size_t> offsets;
+  std::string body;
+  size_t position;
+  if (StringExpect(source, std::string(1, close), offset)) {
+    BeginContainer(bytes, object ? kJsonTypeObject : kJsonTypeArray, 0);
+    FinishContainer(bytes, bytes.length() - kBinaryHeaderSize, offsets, body);
+    return;
+  }
+  for (;;) {
+    offsets.push_back(body.length());
+    if (object) {
+      if (!StringExpect(source, kStringDoubleQuote, offset)) {
+        throw std::runtime_error("document: initial quote key");
+      }
+      position = source.find(kStringDoubleQuote, offset);
+      if (position == std::string::npos) {
+        throw std::runtime_error("document: final quote key");
+      }
+      AppendString(body, source.substr(offset, position - offset));
+      offset = position + 1;
+      if (!StringExpect(source, kStringColon, offset)) {
+        throw std::runtime_error("document: colon separator");
+      }
+    }
+    EncodeTextValue(source, offset, border, body);
+    if (!StringExpect(source, kStringEmpty, offset)) {
+      throw std::runtime_error("document: missing terminator");
+    }
+    if (source[offset] == kCharComma) {
+      offset++;
+      continue;
+    } else if (source[offset] == close) {
+      offset++;
+      break;
+    } else {
+      throw std::runtime_error("document: invalid terminator");
+    }
+  }
+  const size_t start = bytes.length();
+  BeginContainer(bytes, object ? kJsonTypeObject : kJsonTypeArray,
+                 offsets.size());
+  FinishContainer(bytes, start, offsets, body);
+}
+
+static void EncodeArray(const JsonArray &array, std::string &bytes);
+
+static void EncodeObject(const JsonObject &object, std::string &bytes) {
+  std::vector<std::string> keys = object.Keys();
+  std::vector<size_t> offsets;
+  std::string body;
+  for (size_t i = 0; i < keys.size(); i++) {
+    offsets.push_back(body.length());
+    AppendString(body, keys[i]);
+    if (object.IsNull(keys[i])) {
+      Append<uint8_t>(body, kJsonTypeNull);
+    } else if (object.IsBoolean(keys[i])) {
+      Append<uint8_t>(body, kJsonTypeBoolean);
+      Append<uint8_t>(body, object.GetBoolean(keys[i]));
+    } else if (object.IsInteger(keys[i])) {
+      Append<uint8_t>(body, kJsonTypeInteger);
+      Append<JsonInteger>(body, object.GetInteger(keys[i]));
+    } else if (object.IsFloat(keys[i])) {
+      Append<uint8_t>(body, kJsonTypeFloat);
+      Append<JsonFloat>(body, object.GetFloat(keys[i]));
+    } else if (object.IsString(keys[i])) {
+      Append<uint8_t>(body, kJsonTypeString);
+      AppendString(body, object.GetString(keys[i]));
+    } else if (object.IsObject(keys[i])) {
+      EncodeObject(object.GetObject(keys[i]), body);
+    } else if (object.IsArray(keys[i])) {
+      EncodeArray(object.GetArray(keys[i]), body);
+    } else {
+      throw std::runtime_error("incompatible json type");
+    }
+  }
+  const size_t start = bytes.length();
+  BeginContainer(bytes, kJsonTypeObject, offsets.size());
+  FinishContainer(bytes, start, offsets, body);
+}
+
+static void EncodeArray(const JsonArray &array, std::string &bytes) {
+  std::vector<size_t> offsets;
+  std::string body;
+  for (size_t i = 0; i < array.Size(); i++) {
+    offsets.push_back(body.length());
+    if (array.IsNull(i)) {
+      Append<uint8_t>(body, kJsonTypeNull);
+    } else if (array.IsBoolean(i)) {
+      Append<uint8_t>(body, kJsonTypeBoolean);
+      Append<uint8_t>(body, array.GetBoolean(i));
+    } else if (array.IsInteger(i)) {
+      Append<uint8_t>(body, kJsonTypeInteger);
+      Append<JsonInteger>(body, array.GetInteger(i));
+    } else if (array.IsFloat(i)) {
+      Append<uint8_t>(body, kJsonTypeFloat);
+      Append<JsonFloat>(body, array.GetFloat(i));
+    } else if (array.IsString(i)) {
+      Append<uint8_t>(body, kJsonTypeString);
+      AppendString(body, array.GetString(i));
+    } else if (array.IsObject(i)) {
+      EncodeObject(array.GetObject(i), body);
+    } else if (array.IsArray(i)) {
+      EncodeArray(array.GetArray(i), body);
+    } else {
+      throw std::runtime_error("incompatible json type");
+    }
+  }
+  const size_t start = bytes.length();
+  BeginContainer(bytes, kJsonTypeArray, offsets.size());
+  FinishContainer(bytes, start, offsets, body);
+}
+
+static std::string ReadString(const std::string &bytes, size_t position) {
+  return bytes.substr(position + sizeof(BinaryOffset),
+                      Read<BinaryOffset>(bytes, position));
+}
+
+static inline size_t SkipKey(const std::string &bytes, size_t position) {
+  return position + sizeof(BinaryOffset) + Read<BinaryOffset>(bytes, position);
+}
+
+static void Render(const std::string &bytes, size_t position,
+                   std::string &text) {
+  const uint8_t type = bytes[position];
+  switch (type) {
+    case kJsonTypeNull:
+      text += kJsonNull;
+      return;
+    case kJsonTypeBoolean:
+      text += Read<uint8_t>(bytes, position + 1) ? kJsonTrue : kJsonFalse;
+      return;
+    case kJsonTypeInteger:
+      text += std::to_string(Read<JsonInteger>(bytes, position + 1));
+      return;
+    case kJsonTypeFloat:
+      text += std::to_string(Read<JsonFloat>(bytes, position + 1));
+      return;
+    case kJsonTypeString:
+      text += kStringDoubleQuote + ReadString(bytes, position + 1) +
+              kStringDoubleQuote;
+      return;
+    case kJsonTypeObject:
+      [[fallthrough]];
+    case kJsonTypeArray:
+      break;
+    default:
+      throw std::runtime_error("document: invalid type");
+  }
+  const size_t count = CountAt(bytes, position);
+  text += type == kJsonTypeObject ? kStringCurlyBracketOpen
+                                  : kStringSquareBracketOpen;
+  for (size_t i = 0; i < count; i++) {
+    if (i > 0) {
+      text += kStringComma;
+    }
+    size_t entry = EntryAt(bytes, position, i);
+    if (type == kJsonTypeObject) {
+      text += kStringDoubleQuote + ReadString(bytes, entry) +
+              kStringDoubleQuote + kStringColon;
+      entry = SkipKey(bytes, entry);
+    }
+    Render(bytes, entry, text);
+  }
+  text += type == kJsonTypeObject ? kStringCurlyBracketClose
+                                  : kStringSquareBracketClose;
+}
+
+static JsonArray DecodeArray(const std::string &bytes, size_t position);
+
+static JsonObject DecodeObject(const std::string &bytes, size_t position) {
+  JsonObject object;
+  const size_t count = CountAt(bytes, position);
+  for (size_t i = 0; i < count; i++) {
+    size_t entry = EntryAt(bytes, position, i);
+    std::string key = ReadString(bytes, entry);
+    entry = SkipKey(bytes, entry);
+    switch ((uint8_t)bytes[entry]) {
+      case kJsonTypeNull:
+        object.PutNull(key);
+        break;
+      case kJsonTypeBoolean:
+        object.PutBoolean(key, Read<uint8_t>(bytes, entry + 1));
+        break;
+      case kJsonTypeInteger:
+        object.PutInteger(key, Read<JsonInteger>(bytes, entry + 1));
+        break;
+      case kJsonTypeFloat:
+        object.PutFloat(key, Read<JsonFloat>(bytes, entry + 1));
+        break;
+      case kJsonTypeString:
+        object.PutString(key, ReadString(bytes, entry + 1));
+        break;
+      case kJsonTypeObject:
+        object.PutObject(key, DecodeObject(bytes, entry));
+        break;
+      case kJsonTypeArray:
+        object.PutArray(key, DecodeArray(bytes, entry));
+        break;
+      default:
+        throw std::runtime_error("document: invalid type");
+    }
+  }
+  return object;
+}
+
+static JsonArray DecodeArray(const std::string &bytes, size_t position) {
+  JsonArray array;
+  const size_t count = CountAt(bytes, position);
+  for (size_t i = 0; i < count; i++) {
+    size_t entry = EntryAt(bytes, position, i);
+    switch ((uint8_t)bytes[entry]) {
+      case kJsonTypeNull:
+        array.PutNull();
+        break;
+      case kJsonTypeBoolean:
+        array.PutBoolean(Read<uint8_t>(bytes, entry + 1));
+        break;
+      case kJsonTypeInteger:
+        array.PutInteger(Read<JsonInteger>(bytes, entry + 1));
+        break;
+      case kJsonTypeFloat:
+        array.PutFloat(Read<JsonFloat>(bytes, entry + 1));
+        break;
+      case kJsonTypeString:
+        array.PutString(ReadString(bytes, entry + 1));
+        break;
+      case kJsonTypeObject:
+        array.PutObject(DecodeObject(bytes, entry));
+        break;
+      case kJsonTypeArray:
+        array.PutArray(DecodeArray(bytes, entry));
+        break;
+      default:
+        throw std::runtime_error("document: invalid type");
+    }
+  }
+  return array;
+}
+
+}  // namespace document
+
+BinaryDocument::BinaryDocument() {}
+
+BinaryDocument::BinaryDocument(const BinaryDocument &document)
+    : bytes_(document.bytes_) {}
+
+BinaryDocument::BinaryDocument(const std::string &source) { Parse(source); }
+
+BinaryDocument::BinaryDocument(const JsonObject &object) {
+  document::EncodeObject(object, bytes_);
+}
+
+BinaryDocument::~BinaryDocument() {}
+
+bool BinaryDocument::operator==(const BinaryDocument &other) const {
+  return bytes_ == other.bytes_;
+}
+
+bool BinaryDocument::operator!=(const BinaryDocument &other) const {
+  return !(*this == other);
+}
+
+bool BinaryDocument::IsEmpty() const { return bytes_.empty(); }
+
+uint8_t BinaryDocument::GetType() const {
+  if (bytes_.empty()) {
+    return kJsonTypeNull;
+  }
+  return bytes_[0];
+}
+
+size_t BinaryDocument::Size() const {
+  const uint8_t type = GetType();
+  if (type != kJsonTypeObject && type != kJsonTypeArray) {
+    return 0;
+  }
+  return document::CountAt(bytes_, 0);
+}
+
+size_t BinaryDocument::Locate(const std::string &key) const {
+  if (GetType() != kJsonTypeObject) {
+    return std::string::npos;
+  }
+  const size_t count = document::CountAt(bytes_, 0);
+  for (size_t i = 0; i < count; i++) {
+    size_t entry = document::EntryAt(bytes_, 0, i);
+    size_t length = document::Read<BinaryOffset>(bytes_, entry);
+    if (length == key.length() &&
+        bytes_.compare(entry + sizeof(BinaryOffset), length, key) == 0) {
+      return entry + sizeof(BinaryOffset) + length;
+    }
+  }
+  return std::string::npos;
+}
+
+uint8_t BinaryDocument::TypeAt(const std::string &key) const {
+  const size_t position = Locate(key);
+  if (position == std::string::npos) {
+    throw std::out_of_range("document: key not found");
+  }
+  return bytes_[position];
+}
+
+bool BinaryDocument::Has(const std::string &key) const {
+  return Locate(key) != std::string::npos;
+}
+
+std::vector<std::string> BinaryDocument::Keys() const {
+  std::vector<std::string> keys;
+  if (GetType() != kJsonTypeObject) {
+    return keys;
+  }
+  const size_t count = document::CountAt(bytes_, 0);
+  keys.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    keys.emplace_back(
+        document::ReadString(bytes_, document::EntryAt(bytes_, 0, i)));
+  }
+  return keys;
+}
+
+bool BinaryDocument::IsNull(const std::string &key) const {
+  return TypeAt(key) == kJsonTypeNull;
+}
+
+bool BinaryDocument::IsBoolean(const std::string &key) const {
+  return TypeAt(key) == kJsonTypeBoolean;
+}
+
+bool BinaryDocument::IsInteger(const std::string &key) const {
+  return TypeAt(key) == kJsonTypeInteger;
+}
+
+bool BinaryDocument::IsFloat(const std::string &key) const {
+  return TypeAt(key) == kJsonTypeFloat;
+}
+
+bool BinaryDocument::IsString(const std::string &key) const {
+  return TypeAt(key) == kJsonTypeString;
+}
+
+bool BinaryDocument::IsObject(const std::string &key) const {
+  return TypeAt(key) == kJsonTypeObject;
+}
+
+bool BinaryDocument::IsArray(const std::string &key) const {
+  return TypeAt(key) == kJsonTypeArray;
+}
+
+JsonBoolean BinaryDocument::GetBoolean(const std::string &key) const {
+  if (TypeAt(key) != kJsonTypeBoolean) {
+    throw std::runtime_error("invalid type");
+  }
+  return document::Read<uint8_t>(bytes_, Locate(key) + 1);
+}
+
+JsonInteger BinaryDocument::GetInteger(const std::string &key) const {
+  if (TypeAt(key) != kJsonTypeInteger) {
+    throw std::runtime_error("invalid type");
+  }
+  return document::Read<JsonInteger>(bytes_, Locate(key) + 1);
+}
+
+JsonFloat BinaryDocument::GetFloat(const std::string &key) const {
+  const uint8_t type = TypeAt(key);
+  if (type == kJsonTypeFloat) {
+    return document::Read<JsonFloat>(bytes_, Locate(key) + 1);
+  } else if (type == kJsonTypeInteger) {
+    return (JsonFloat)document::Read<JsonInteger>(bytes_, Locate(key) + 1);
+  }
+  throw std::runtime_error("invalid type");
+}
+
+JsonString BinaryDocument::GetString(const std::string &key) const {
+  if (TypeAt(key) != kJsonTypeString) {
+    throw std::runtime_error("invalid type");
+  }
+  return document::ReadString(bytes_, Locate(key) + 1);
+}
+
+BinaryDocument BinaryDocument::GetDocument(const std::string &key) const {
+  const size_t position = Locate(key);
+  if (position == std::string::npos) {
+    throw std::out_of_range("document: key not found");
+  }
+  BinaryDocument result;
+  result.bytes_ =
+      bytes_.substr(position, document::ValueSize(bytes_, position));
+  return result;
+}
+
+BinaryDocument BinaryDocument::GetDocument(size_t index) const {
+  if (GetType() != kJsonTypeArray || index >= Size()) {
+    throw std::out_of_range("document: index out of range");
+  }
+  const size_t position = document::EntryAt(bytes_, 0, index);
+  BinaryDocument result;
+  result.bytes_ =
+      bytes_.substr(position, document::ValueSize(bytes_, position));
+  return result;
+}
+
+JsonObject BinaryDocument::ToObject() const {
+  if (GetType() != kJsonTypeObject) {
+    throw std::runtime_error("invalid type");
+  }
+  return document::DecodeObject(bytes_, 0);
+}
+
+JsonArray BinaryDocument::ToArray() const {
+  if (GetType() != kJsonTypeArray) {
+    throw std::runtime_error("invalid type");
+  }
+  return document::DecodeArray(bytes_, 0);
+}
+
+const std::string &BinaryDocument::GetBytes() const { return bytes_; }
+
+void BinaryDocument::SetBytes(const std::string &bytes) { bytes_ = bytes; }
+
+void BinaryDocument::Clear() { bytes_.clear(); }
+
+std::string BinaryDocument::String() const {
+  std::string text;
+  if (bytes_.empty()) {
+    return kJsonNull;
+  }
+  text.reserve(bytes_.length());
+  document::Render(bytes_, 0, text);
+  return text;
+}
+
+void BinaryDocument::Parse(const std::string &source) {
+  size_t offset = 0;
+  bytes_.clear();
+  document::EncodeText(source, offset, bytes_);
+}
+
+namespace document {
+
+static bool IsValidString(const std::string &bytes, size_t position,
+                          size_t end) {
+  return position <= end && end - position >= sizeof(BinaryOffset) &&
+         Read<BinaryOffset>(bytes, position) <=
+             end - position - sizeof(BinaryOffset);
+}
+
+static bool IsValid(const std::string &bytes, size_t position, size_t end) {
+  if (position >= end) {
+    return false;
+  }
+  const size_t remaining = end - position;
+  switch ((uint8_t)bytes[position]) {
+    case kJsonTypeNull:
+      return true;
+    case kJsonTypeBoolean:
+      return remaining >= sizeof(uint8_t) + sizeof(uint8_t);
+    case kJsonTypeInteger:
+      return remaining >= sizeof(uint8_t) + sizeof(JsonInteger);
+    case kJsonTypeFloat:
+      return remaining >= sizeof(uint8_t) + sizeof(JsonFloat);
+    case kJsonTypeString:
+      return IsValidString(bytes, position + sizeof(uint8_t), end);
+    case kJsonTypeObject:
+      [[fallthrough]];
+    case kJsonTypeArray:
+      break;
+    default:
+      return false;
+  }
+  if (remaining < kBinaryHeaderSize) {
+    return false;
+  }
+  const size_t size = ValueSize(bytes, position);
+  const size_t count = CountAt(bytes, position);
+  if (size < kBinaryHeaderSize || size > remaining ||
+      count > (size - kBinaryHeaderSize) / sizeof(BinaryOffset)) {
+    return false;
+  }
+  const size_t limit = position + size;
+  const size_t base = kBinaryHeaderSize + count * sizeof(BinaryOffset);
+  const bool object = (uint8_t)bytes[position] == kJsonTypeObject;
+  for (size_t i = 0; i < count; i++) {
+    size_t offset = Read<BinaryOffset>(
+        bytes, position + kBinaryHeaderSize + i * sizeof(BinaryOffset));
+    if (offset < base || offset >= size) {
+      return false;
+    }
+    size_t entry = position + offset;
+    if (object) {
+      if (!IsValidString(bytes, entry, limit)) {
+        return false;
+      }
+      entry = SkipKey(bytes, entry);
+    }
+    if (!IsValid(bytes, entry, limit)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool IsValid(const std::string &bytes) {
+  const size_t length = bytes.length();
+  if (length == 0) {
+    return true;
+  }
+  return IsValid(bytes, 0, length) && ValueSize(bytes, 0) == length;
+}
+
+size_t Serialize(const BinaryDocument &document, std::ostream &stream) {
+  const std::string &bytes = document.GetBytes();
+  size_t length = bytes.length();
+  stream.write((const char *)&length, sizeof(size_t));
+  stream.write((const char *)&bytes[0], length);
+  return stream ? sizeof(size_t) + length : std::string::npos;
+}
+
+size_t Deserialize(BinaryDocument &document, std::istream &stream) {
+  size_t length;
+  std::string bytes;
+  stream.read((char *)&length, sizeof(size_t));
+  if (!stream) {
+    return std::string::npos;
+  }
+  bytes.resize(length);
+  stream.read((char *)&bytes[0], length);
+  if (!stream) {
+    return std::string::npos;
+  }
+  if (!IsValid(bytes)) {
+    return std::string::npos;
+  }
+  document.SetBytes(bytes);
+  return sizeof(size_t) + length;
+}
+
+size_t Deserialize(BinaryDocument &document, EncodingReader &reader) {
+  size_t length;
+  if (encoding::ReadBytes(reader, &length, sizeof(size_t)) ==
+      std::string::npos) {
+    return std::string::npos;
+  }
+  const char *source = reader.Take(length);
+  if (source == nullptr) {
+    return std::string::npos;
+  }
+  std::string bytes(source, length);
+  if (!IsValid(bytes)) {
+    return std::string::npos;
+  }
+  document.SetBytes(bytes);
+  return sizeof(size_t) + length;
+}
+
+uint64_t Memory(const BinaryDocument &document) {
+  return sizeof(BinaryDocument) + document.GetBytes().capacity();
+}
+
+}  // namespace document
\ No newline at end of file
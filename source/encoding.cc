@@ -0,0 +1,489 @@
+/* Copyright 2022 Jonas Hegemann <jonas.hegemann@hotmail.de>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "encoding.h"
+
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+static const int kEncodingVersionIndex = std::ios_base::xalloc();
+static const int kEncodingDictionaryIndex = std::ios_base::xalloc();
+
+EncodingDictionary::EncodingDictionary() {}
+
+EncodingDictionary::~EncodingDictionary() {}
+
+size_t EncodingDictionary::Find(const std::string &key) const {
+  auto lookup = index_.find(key);
+  if (lookup == index_.end()) {
+    return std::string::npos;
+  }
+  return lookup->second;
+}
+
+const std::string &EncodingDictionary::Get(size_t index) const {
+  return keys_.at(index);
+}
+
+bool EncodingDictionary::Add(const std::string &key) {
+  if (keys_.size() >= kEncodingDictionaryMaximum) {
+    return false;
+  }
+  if (!index_.insert(std::make_pair(key, keys_.size())).second) {
+    return false;
+  }
+  keys_.emplace_back(key);
+  return true;
+}
+
+size_t EncodingDictionary::Size() const { return keys_.size(); }
+
+void EncodingDictionary::Clear() {
+  index_.clear();
+  keys_.clear();
+}
+
+EncodingReader::EncodingReader(const char *data, size_t size)
+    : data_(data),
+      size_(size),
+      offset_(0),
+      good_(true),
+      version_(kEncodingVersionLegacy),
+      dictionary_(nullptr) {}
+
+EncodingReader::~EncodingReader() {}
+
+EncodingReader::operator bool() const { return good_; }
+
+const char *EncodingReader::Take(size_t length) {
+  if (!good_ || length > size_ - offset_) {
+    good_ = false;
+    return nullptr;
+  }
+  const char *result = data_ + offset_;
+  offset_ += length;
+  return result;
+}
+
+const char *EncodingReader::Current() const { return data_ + offset_; }
+
+size_t EncodingReader::Offset() const { return offset_; }
+
+size_t EncodingReader::Size() const { return size_; }
+
+size_t EncodingReader::Remaining() const { return size_ - offset_; }
+
+void EncodingReader::SetVersion(uint8_t version) { version_ = version; }
+
+uint8_t EncodingReader::GetVersion() const { return version_; }
+
+void EncodingReader::SetDictionary(EncodingDictionary *dictionary) {
+  dictionary_ = dictionary;
+}
+
+EncodingDictionary *EncodingReader::GetDictionary() const {
+  return dictionary_;
+}
+
+MappedFile::MappedFile() : descriptor_(-1), data_(nullptr), size_(0) {}
+
+MappedFile::~MappedFile() { Close(); }
+
+bool MappedFile::Open(const std::string &filepath, int advice) {
+  Close();
+  descriptor_ = open(filepath.c_str(), O_RDONLY);
+  if (descriptor_ < 0) {
+    return false;
+  }
+  struct stat status;
+  if (fstat(descriptor_, &status) != 0) {
+    Close();
+    return false;
+  }
+  size_ = status.st_size;
+  if (size_ == 0) {
+    return true;
+  }
+  data_ = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, descriptor_, 0);
+  if (data_ == MAP_FAILED) {
+    data_ = nullptr;
+    Close();
+    return false;
+  }
+  madvise(data_, size_, advice);
+  return true;
+}
+
+void MappedFile::Close() {
+  if (data_ != nullptr) {
+    munmap(data_, size_);
+    data_ = nullptr;
+  }
+  if (descriptor_ >= 0) {
+    close(descriptor_);
+    descriptor_ = -1;
+  }
+  size_ = 0;
+}
+
+const char *MappedFile::GetData() const {
+  return static_cast<const char *>(data_);
+}
+
+size_t MappedFile::Size() const { return size_; }
+
+namespace encoding {
+
+void SetVersion(std::ios_base &stream, uint8_t version) {
+  stream.iword(kEncodingVersionIndex) = version;
+}
+
+uint8_t GetVersion(std::ios_base &stream) {
+  long version = stream.iword(kEncodingVersionIndex);
+  return version == 0 ? kEncodingVersionLegacy : (uint8_t)version;
+}
+
+bool IsLegacy(std::ios_base &stream) {
+  return GetVersion(stream) == kEncodingVersionLegacy;
+}
+
+void SetDictionary(std::ios_base &stream, EncodingDictionary *dictionary) {
+  stream.pword(kEncodingDictionaryIndex) = dictionary;
+}
+
+EncodingDictionary *GetDictionary(std::ios_base &stream) {
+  return static_cast<EncodingDictionary *>(
+      stream.pword(kEncodingDictionaryIndex));
+}
+
+size_t WriteHeader(std::ostream &stream, uint8_t flags, uint8_t codec) {
+  stream.write(kEncodingMagic.data(), kEncodingMagic.length());
+  stream.write((const char *)&kEncodingVersion2, sizeof(uint8_t));
+  stream.write((const char *)&flags, sizeof(uint8_t));
+  size_t bytes = kEncodingHeaderSize;
+  if (flags & kEncodingFlagCompressed) {
+    stream.write((const char *)&codec, sizeof(uint8_t));
+    bytes += sizeof(uint8_t);
+  }
+  SetVersion(stream, kEncodingVersion2);
+  return stream ? bytes : std::string::npos;
+}
+
+size_t ReadHeader(std::istream &stream, uint8_t &flags) {
+  flags = 0;
+  std::streampos start = stream.tellg();
+  std::string magic(kEncodingMagic.length(), kCharNullTerminator);
+  stream.read(&magic[0], magic.length());
+  if (!stream || magic != kEncodingMagic) {
+    stream.clear();
+    stream.seekg(start);
+    SetVersion(stream, kEncodingVersionLegacy);
+    return stream ? 0 : std::string::npos;
+  }
+  uint8_t version;
+  stream.read((char *)&version, sizeof(uint8_t));
+  stream.read((char *)&flags, sizeof(uint8_t));
+  if (!stream || version != kEncodingVersion2) {
+    return std::string::npos;
+  }
+  SetVersion(stream, version);
+  return kEncodingHeaderSize;
+}
+
+size_t WriteVarint(std::ostream &stream, uint64_t value) {
+  char buffer[kEncodingVarintMaximum];
+  size_t length = 0;
+  while (value >= 0x80) {
+    buffer[length++] = (char)(value | 0x80);
+    value >>= 7;
+  }
+  buffer[length++] = (char)value;
+  stream.write(buffer, length);
+  return stream ? length : std::string::npos;
+}
+
+size_t ReadVarint(std::istream &stream, uint64_t &value) {
+  value = 0;
+  for (size_t i = 0; i < kEncodingVarintMaximum; i++) {
+    int byte = stream.get();
+    if (byte == std::char_traits<char>::eof()) {
+      return std::string::npos;
+    }
+    value |= (uint64_t)(byte & 0x7f) << (7 * i);
+    if (!(byte & 0x80)) {
+      return i + 1;
+    }
+  }
+  return std::string::npos;
+}
+
+uint64_t ZigZagEncode(int64_t value) {
+  return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+int64_t ZigZagDecode(uint64_t value) {
+  return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+size_t WriteLength(std::ostream &stream, size_t length) {
+  if (IsLegacy(stream)) {
+    stream.write((const char *)&length, sizeof(size_t));
+    return stream ? sizeof(size_t) : std::string::npos;
+  }
+  return WriteVarint(stream, length);
+}
+
+size_t ReadLength(std::istream &stream, size_t &length) {
+  if (IsLegacy(stream)) {
+    stream.read((char *)&length, sizeof(size_t));
+    return stream ? sizeof(size_t) : std::string::npos;
+  }
+  uint64_t value;
+  size_t bytes = ReadVarint(stream, value);
+  length = value;
+  return bytes;
+}
+
+size_t WriteString(std::ostream &stream, const std::string &value) {
+  size_t bytes = WriteLength(stream, value.length());
+  if (bytes == std::string::npos) {
+    return bytes;
+  }
+  stream.write(value.data(), value.length());
+  return stream ? bytes + value.length() : std::string::npos;
+}
+
+size_t ReadString(std::istream &stream, std::string &value) {
+  size_t length;
+  size_t bytes = ReadLength(stream, length);
+  if (bytes == std::string::npos) {
+    return bytes;
+  }
+  value.resize(length);
+  stream.read(&value[0], length);
+  return stream ? bytes + length : std::string::npos;
+}
+
+size_t WriteKey(std::ostream &stream, const std::string &key) {
+  EncodingDictionary *dictionary = GetDictionary(stream);
+  if (IsLegacy(stream) || dictionary == nullptr) {
+    return WriteString(stream, key);
+  }
+  size_t index = dictionary->Find(key);
+  if (index != std::string::npos) {
+    return WriteVarint(stream, (index << 1) | 1);
+  }
+  size_t bytes = WriteVarint(stream, key.length() << 1);
+  if (bytes == std::string::npos) {
+    return bytes;
+  }
+  stream.write(key.data(), key.length());
+  dictionary->Add(key);
+  return stream ? bytes + key.length() : std::string::npos;
+}
+
+size_t ReadKey(std::istream &stream, std::string &key) {
+  EncodingDictionary *dictionary = GetDictionary(stream);
+  if (IsLegacy(stream) || dictionary == nullptr) {
+    return ReadString(stream, key);
+  }
+  uint64_t value;
+  size_t bytes = ReadVarint(stream, value);
+  if (bytes == std::string::npos) {
+    return bytes;
+  }
+  if (value & 1) {
+    if ((value >> 1) >= dictionary->Size()) {
+      return std::string::npos;
+    }
+    key = dictionary->Get(value >> 1);
+    return bytes;
+  }
+  key.resize(value >> 1);
+  stream.read(&key[0], key.length());
+  dictionary->Add(key);
+  return stream ? bytes + key.length() : std::string::npos;
+}
+
+bool IsLegacy(const EncodingReader &reader) {
+  return reader.GetVersion() == kEncodingVersionLegacy;
+}
+
+size_t ReadHeader(EncodingReader &reader, uint8_t &flags) {
+  uint8_t codec;
+  size_t bytes = ReadHeader(reader, flags, codec);
+  if (flags & kEncodingFlagCompressed) {
+    return std::string::npos;
+  }
+  return bytes;
+}
+
+size_t ReadHeader(EncodingReader &reader, uint8_t &flags, uint8_t &codec) {
+  flags = 0;
+  codec = 0;
+  reader.SetVersion(kEncodingVersionLegacy);
+  if (reader.Remaining() < kEncodingHeaderSize ||
+      memcmp(reader.Current(), kEncodingMagic.data(),
+             kEncodingMagic.length()) != 0) {
+    return 0;
+  }
+  const char *header = reader.Take(kEncodingHeaderSize);
+  uint8_t version = header[kEncodingMagic.length()];
+  flags = header[kEncodingMagic.length() + 1];
+  if (version != kEncodingVersion2) {
+    return std::string::npos;
+  }
+  reader.SetVersion(version);
+  if (flags & kEncodingFlagCompressed) {
+    if (ReadBytes(reader, &codec, sizeof(uint8_t)) == std::string::npos) {
+      return std::string::npos;
+    }
+    return kEncodingHeaderSize + sizeof(uint8_t);
+  }
+  return kEncodingHeaderSize;
+}
+
+size_t ReadBytes(std::istream &stream, void *destination, size_t length) {
+  stream.read((char *)destination, length);
+  return stream ? length : std::string::npos;
+}
+
+size_t ReadBytes(EncodingReader &reader, void *destination, size_t length) {
+  const char *source = reader.Take(length);
+  if (source == nullptr) {
+    return std::string::npos;
+  }
+  memcpy(destination, source, length);
+  return length;
+}
+
+size_t ReadVarint(EncodingReader &reader, uint64_t &value) {
+  value = 0;
+  const char *byte;
+  for (size_t i = 0; i < kEncodingVarintMaximum; i++) {
+    byte = reader.Take(1);
+    if (byte == nullptr) {
+      return std::string::npos;
+    }
+    value |= (uint64_t)(*byte & 0x7f) << (7 * i);
+    if (!(*byte & 0x80)) {
+      return i + 1;
+    }
+  }
+  return std::string::npos;
+}
+
+size_t ReadLength(EncodingReader &reader, size_t &length) {
+  if (IsLegacy(reader)) {
+    return ReadBytes(reader, &length, sizeof(size_t));
+  }
+  uint64_t value;
+  size_t bytes = ReadVarint(reader, value);
+  length = value;
+  return bytes;
+}
+
+size_t ReadString(EncodingReader &reader, std::string &value) {
+  size_t length;
+  size_t bytes = ReadLength(reader, length);
+  if (bytes == std::string::npos) {
+    return bytes;
+  }
+  const char *source = reader.Take(length);
+  if (source == nullptr) {
+    return std::string::npos;
+  }
+  value.assign(source, length);
+  return bytes + length;
+}
+
+size_t ReadKey(EncodingReader &reader, std::string &key) {
+  EncodingDictionary *dictionary = reader.GetDictionary();
+  if (IsLegacy(reader) || dictionary == nullptr) {
+    return ReadString(reader, key);
+  }
+  uint64_t value;
+  size_t bytes = ReadVarint(reader, value);
+  if (bytes == std::string::npos) {
+    return bytes;
+  }
+  if (value & 1) {
+    if ((value >> 1) >= dictionary->Size()) {
+      return std::string::npos;
+    }
+    key = dictionary->Get(value >> 1);
+    return bytes;
+  }
+  const char *source = reader.Take(value >> 1);
+  if (source == nullptr) {
+    return std::string::npos;
+  }
+  key.assign(source, value >> 1);
+  dictionary->Add(key);
+  return bytes + key.length();
+}
+
+#if defined(__SSE4_2__)
+uint32_t Crc32c(const char *data, size_t length, uint32_t crc) {
+  uint64_t value = ~crc;
+  uint64_t word;
+  for (; length >= sizeof(uint64_t); length -= sizeof(uint64_t)) {
+    memcpy(&word, data, sizeof(uint64_t));
+    value = _mm_crc32_u64(value, word);
+    data += sizeof(uint64_t);
+  }
+  for (; length > 0; length--) {
+    value = _mm_crc32_u8((uint32_t)value, (uint8_t)*data++);
+  }
+  return ~(uint32_t)value;
+}
+#elif defined(__ARM_FEATURE_CRC32)
+uint32_t Crc32c(const char *data, size_t length, uint32_t crc) {
+  uint32_t value = ~crc;
+  uint64_t word;
+  for (; length >= sizeof(uint64_t); length -= sizeof(uint64_t)) {
+    memcpy(&word, data, sizeof(uint64_t));
+    value = __crc32cd(value, word);
+    data += sizeof(uint64_t);
+  }
+  for (; length > 0; length--) {
+    value = __crc32cb(value, (uint8_t)*data++);
+  }
+  return ~value;
+}
+#else
+uint32_t Crc32c(const char *data, size_t length, uint32_t crc) {
+  static const std::vector<uint32_t> table = [] {
+    std::vector<uint32_t> table(256);
+    for (uint32_t idx = 0; idx < 256; idx++) {
+      uint32_t entry = idx;
+      for (int bit = 0; bit < 8; bit++) {
+        entry = (entry >> 1) ^ (entry & 1 ? kEncodingCrc32cPolynomial : 0);
+      }
+      table[idx] = entry;
+    }
+    return table;
+  }();
+  uint32_t value = ~crc;
+  for (; length > 0; length--) {
+    value = (value >> 8) ^ table[(value ^ (uint8_t)*data++) & 0xff];
+  }
+  return ~value;
+}
+#endif
+
+}  // namespace encoding
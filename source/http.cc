@@ -181,7 +181,10 @@ const std::string &HttpPacket::GetBody() const { return body_; }
 void HttpPacket::ClearBody() { body_.clear(); }
 
 HttpRequest::HttpRequest()
-    : method_(GET), url_(kStringSlash), protocol_(kHttpProtocol1_1) {}
+    : method_(GET),
+      url_(kStringSlash),
+      protocol_(kHttpProtocol1_1),
+      arena_(std::pmr::get_default_resource()) {}
 
 HttpRequest::~HttpRequest() {}
 
@@ -197,6 +200,12 @@ void HttpRequest::SetMethod(const HttpMethod method) { method_ = method; }
 
 const HttpMethod &HttpRequest::GetMethod() const { return method_; }
 
+void HttpRequest::SetArena(std::pmr::memory_resource *arena) {
+  arena_ = arena;
+}
+
+std::pmr::memory_resource *HttpRequest::GetArena() const { return arena_; }
+
 void HttpRequest::SetUrl(const std::string &url) { url_ = url; }
 
 const std::string &HttpRequest::GetUrl() const { return url_; }
@@ -306,13 +315,21 @@ const std::string HttpResponse::AsShortString() const {
   return packet.str();
 }
 
+HttpStream::HttpStream() {}
+
+HttpStream::~HttpStream() {}
+
 HttpConnection::HttpConnection(TcpSocket *socket)
-    : stage_(START),
+    : arena_buffer_(kHttpArenaSize),
+      arena_(arena_buffer_.data(), arena_buffer_.size()),
+      stage_(START),
       count_headers_(0),
+      body_length_(0),
       socket_(socket),
       expiry_(TimeEpochMilliseconds() + kHttpConnectionTimeout) {
   reader_ = new TcpReader(socket);
   writer_ = new TcpWriter(socket);
+  request_.SetArena(&arena_);
 }
 
 HttpConnection::~HttpConnection() {
@@ -332,6 +349,12 @@ const HttpRequest &HttpConnection::GetRequest() const { return request_; }
 
 const HttpResponse &HttpConnection::GetResponse() const { return response_; }
 
+HttpStream *HttpConnection::GetStream() const { return stream_.get(); }
+
+void HttpConnection::SetStreamOpener(HttpStreamOpener opener) {
+  opener_ = opener;
+}
+
 long HttpConnection::GetExpiry() const { return expiry_; }
 
 void HttpConnection::ResetExpiry() {
@@ -386,9 +409,16 @@ void HttpConnection::ParseRequest() {
       stage_ = HEADER;
       [[fallthrough]];
     case HEADER:
+      ParseHeaders(request_);
+      if (stage_ != BODY) {
+        return;
+      }
+      if (opener_) {
+        stream_ = opener_(request_);
+      }
       [[fallthrough]];
     case BODY:
-      ParseMessage(request_);
+      ParseBody(request_);
       break;
     default:
       return;
@@ -443,90 +473,97 @@ void HttpConnection::ParseResponse() {
       stage_ = HEADER;
       [[fallthrough]];
     case HEADER:
+      ParseHeaders(response_);
+      if (stage_ != BODY) {
+        return;
+      }
       [[fallthrough]];
     case BODY:
-      ParseMessage(response_);
+      ParseBody(response_);
       break;
     default:
       return;
   }
 }
 
-void HttpConnection::ParseMessage(HttpPacket &packet) {
+void HttpConnection::ParseHeaders(HttpPacket &packet) {
   std::string token;
   std::string key;
   std::string value;
-  std::string content_length_string;
-  size_t content_length;
-  size_t bytes_left;
-  bool headers_complete;
-  switch (stage_) {
-    case HEADER:
-      headers_complete = false;
-      while (count_headers_ <= kHttpMaxHeaderCount) {
-        if (!reader_->Peak(kHttpLineFeed)) {
-          return;
-        }
-        token = reader_->Tok();
-        if (token.empty()) {
-          headers_complete = true;
-          break;
-        }
-        key = StringPopSegment(token, kStringColon + kStringSpace);
-        if (key.empty()) {
-          stage_ = FAILED;
-          return;
-        }
-        value = token;
-        if (value.empty()) {
-          stage_ = FAILED;
-          return;
-        }
-        packet.AddHeader(key, value);
-        count_headers_++;
-      }
-      if (!headers_complete) {
-        stage_ = FAILED;
-        return;
-      }
-      stage_ = BODY;
-      [[fallthrough]];
-    case BODY:
-      content_length_string = packet.GetHeader("content-length");
-      content_length = 0;
-      if (!content_length_string.empty()) {
-        try {
-          content_length = std::atoi(content_length_string.c_str());
-        } catch (std::invalid_argument &) {
-          stage_ = FAILED;
-          return;
-        }
-      }
-      if (content_length == 0) {
-        stage_ = END;
-        return;
-      }
-      bytes_left = content_length - packet.GetBody().length();
-      packet.AppendToBody(reader_->Tok(bytes_left));
-      if (packet.GetBody().length() < content_length) {
-        return;
-      }
-      stage_ = END;
-      [[fallthrough]];
-    case END:
+  bool headers_complete = false;
+  while (count_headers_ <= kHttpMaxHeaderCount) {
+    if (!reader_->Peak(kHttpLineFeed)) {
       return;
-    default:
+    }
+    token = reader_->Tok();
+    if (token.empty()) {
+      headers_complete = true;
+      break;
+    }
+    key = StringPopSegment(token, kStringColon + kStringSpace);
+    if (key.empty()) {
+      stage_ = FAILED;
       return;
+    }
+    value = token;
+    if (value.empty()) {
+      stage_ = FAILED;
+      return;
+    }
+    packet.AddHeader(key, value);
+    count_headers_++;
+  }
+  if (!headers_complete) {
+    stage_ = FAILED;
+    return;
+  }
+  stage_ = BODY;
+}
+
+void HttpConnection::ParseBody(HttpPacket &packet) {
+  std::string content_length_string = packet.GetHeader("content-length");
+  size_t content_length = 0;
+  std::string chunk;
+  if (!content_length_string.empty()) {
+    try {
+      content_length = std::atoi(content_length_string.c_str());
+    } catch (std::invalid_argument &) {
+      stage_ = FAILED;
+      return;
+    }
+  }
+  if (content_length == 0) {
+    stage_ = END;
+    return;
+  }
+  if (!stream_ && content_length > kTcpMaximumPayloadSize) {
+    stage_ = FAILED;
+    return;
+  }
+  chunk = reader_->Tok(content_length - body_length_);
+  reader_->Discard();
+  body_length_ += chunk.length();
+  if (stream_) {
+    stream_->Consume(chunk);
+  } else {
+    packet.AppendToBody(chunk);
+  }
+  if (body_length_ < content_length) {
+    return;
   }
+  stage_ = END;
 }
 
 void HttpConnection::Restart() {
   ResetExpiry();
   stage_ = START;
   count_headers_ = 0;
+  body_length_ = 0;
+  stream_.reset();
   reader_->ClearBuffer();
   request_.Initialize();
   response_.Initialize();
+  arena_.release();
 }
 
 bool HttpConnection::IsGood() { return socket_->IsGood(); }
@@ -548,6 +585,20 @@ void HttpServer::RegisterHandler(HttpMethod method, const std::string &url,
   handlers_.insert(std::make_pair(handler_id, callback));
 }
 
+void HttpServer::RegisterStreamHandler(HttpMethod method,
+                                       const std::string &url,
+                                       HttpStreamCallback callback) {
+  if (running_) {
+    return;
+  }
+  std::string handler_id = HttpConstants::GetMethodString(method) + url;
+  if (stream_handlers_.find(handler_id) != stream_handlers_.end()) {
+    LOG_INFO("stream handler already registered");
+    return;
+  }
+  stream_handlers_.insert(std::make_pair(handler_id, callback));
+}
+
 void HttpServer::RegisterService(const std::string &name, ApiService *service) {
   if (running_) {
     return;
@@ -571,6 +622,17 @@ HttpResponse HttpServer::ExecuteHandler(const HttpRequest &request,
   return response;
 }
 
+std::unique_ptr<HttpStream> HttpServer::OpenStream(
+    const HttpRequest &request) {
+  std::string handler_id(HttpConstants::GetMethodString(request.GetMethod()) +
+                         request.GetUrl());
+  auto it = stream_handlers_.find(handler_id);
+  if (it == stream_handlers_.end()) {
+    return nullptr;
+  }
+  return it->second(request, services_);
+}
+
 void HttpServer::Serve(const std::string &service, const std::string &host) {
   for (auto service : services_) {
     LOG_INFO("initialize service " + service.first);
@@ -610,6 +672,17 @@ void HttpServer::Serve(const std::string &service, const std::string &host) {
     LOG_INFO("cannot add timer descriptor to epoll instance");
     return;
   }
+  for (auto service : services_) {
+    int notifier = service.second->GetNotifier();
+    if (notifier == -1) {
+      continue;
+    }
+    if (!epoll_.AddReadable(notifier)) {
+      LOG_INFO("cannot add notifier descriptor to epoll instance");
+      return;
+    }
+    notifiers_.insert(std::make_pair(notifier, service.second));
+  }
   running_ = true;
   while (running_) {
     int ready = epoll_.Wait();
@@ -639,11 +712,22 @@ void HttpServer::Serve(const std::string &service, const std::string &host) {
         } else if (epoll_.HasErrors(idx)) {
           HandleServerError(service, host);
         }
+      } else if (notifiers_.find(current_descriptor) != notifiers_.end()) {
+        HandleNotifierEvent(idx);
       } else {
         HandleClientEvent(idx);
       }
     }
+    CommitResponses();
+  }
+  LOG_INFO("remove notifier descriptors");
+  for (auto notifier : notifiers_) {
+    epoll_.Delete(notifier.first);
   }
+  notifiers_.clear();
+  commits_.clear();
+  LOG_INFO("delete connections");
+  DeleteAllConnections();
   LOG_INFO("shut down services");
   for (auto service : services_) {
     LOG_INFO("shut down service " + service.first);
@@ -659,8 +743,6 @@ void HttpServer::Serve(const std::string &service, const std::string &host) {
   LOG_INFO("close server socket");
   epoll_.Delete(server_socket_.GetDescriptor());
   server_socket_.Close();
-  LOG_INFO("delete connections");
-  DeleteAllConnections();
   LOG_INFO("release epoll instance");
   epoll_.Release();
   running_ = false;
@@ -761,6 +843,7 @@ void HttpServer::DeleteConnection(int descriptor) {
   }
   LOG_INFO("delete connection " + std::to_string(descriptor));
   epoll_.Delete(descriptor);
+  DropResponses(descriptor);
   delete it_connection->second;
   it_connection = connections_.erase(it_connection);
 }
@@ -774,6 +857,19 @@ void HttpServer::DeleteAllConnections() {
     it_connection = connections_.erase(it_connection);
   }
   connections_.clear();
+  responses_.clear();
+  commits_.clear();
+}
+
+void HttpServer::DropResponses(int descriptor) {
+  responses_.erase(
+      std::remove(responses_.begin(), responses_.end(), descriptor),
+      responses_.end());
+  for (auto &commit : commits_) {
+    commit.second.erase(
+        std::remove(commit.second.begin(), commit.second.end(), descriptor),
+        commit.second.end());
+  }
 }
 
 void HttpServer::DeleteExpiredConnections() {
@@ -785,6 +881,7 @@ void HttpServer::DeleteExpiredConnections() {
       descriptor = it_connection->first;
       LOG_INFO("delete expired connection " + std::to_string(descriptor));
       epoll_.Delete(descriptor);
+      DropResponses(descriptor);
       delete it_connection->second;
       it_connection = connections_.erase(it_connection);
     } else {
@@ -940,6 +1037,8 @@ void HttpServer::HandleServerEvent() {
     return;
   }
   HttpConnection *connection = new HttpConnection(client_socket);
+  connection->SetStreamOpener(
+      [this](const HttpRequest &request) { return OpenStream(request); });
   connections_.insert(
       std::make_pair(client_socket->GetDescriptor(), connection));
 }
@@ -972,13 +1071,17 @@ void HttpServer::HandleClientEvent(int index) {
       LOG_INFO("incoming request: " + connection->GetRequest().AsShortString());
       LOG_INFO("execute handler for connection " + std::to_string(descriptor));
       HttpResponse response =
-          ExecuteHandler(connection->GetRequest(), services_);
+          connection->GetStream() != nullptr
+              ? connection->GetStream()->Finish()
+              : ExecuteHandler(connection->GetRequest(), services_);
       LOG_INFO("response: " + response.AsShortString());
       connection->GetWriter()->Write(response.String());
-      if (!epoll_.SetWriteable(index)) {
-        LOG_INFO("could not set descriptor to write mode");
+      if (!epoll_.Modify(descriptor, EPOLLERR | EPOLLHUP)) {
+        LOG_INFO("could not suspend descriptor until commit");
         DeleteConnection(descriptor);
+        return;
       }
+      responses_.push_back(descriptor);
     }
     if (connection->GetReader()->HasErrors()) {
       LOG_INFO("connection closed by client before response was sent");
@@ -1020,6 +1123,47 @@ void HttpServer::HandleClientEvent(int index) {
   }
 }
 
+void HttpServer::HandleNotifierEvent(int index) {
+  eventfd_t value;
+  if (!epoll_.IsReadable(index) ||
+      eventfd_read(epoll_.GetDescriptor(index), &value) != 0) {
+    return;
+  }
+  ReleaseResponses();
+}
+
+void HttpServer::CommitResponses() {
+  if (responses_.empty()) {
+    return;
+  }
+  std::vector<uint64_t> tickets;
+  for (auto service : services_) {
+    tickets.push_back(service.second->Commit());
+  }
+  commits_.emplace_back(std::move(tickets), std::move(responses_));
+  responses_.clear();
+  ReleaseResponses();
+}
+
+void HttpServer::ReleaseResponses() {
+  while (!commits_.empty()) {
+    size_t idx = 0;
+    for (auto service : services_) {
+      if (service.second->GetCommitted() < commits_.front().first[idx++]) {
+        return;
+      }
+    }
+    std::vector<int> descriptors = std::move(commits_.front().second);
+    commits_.pop_front();
+    for (int descriptor : descriptors) {
+      if (!epoll_.Modify(descriptor, EPOLLOUT | EPOLLERR | EPOLLHUP)) {
+        LOG_INFO("could not set descriptor to write mode");
+        DeleteConnection(descriptor);
+      }
+    }
+  }
+}
+
 namespace http {
 
 std::optional<HttpResponse> SendRequest(
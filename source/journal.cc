@@ -0,0 +1,279 @@
+/* Copyright 2022 Jonas Hegemann <jonas.hegemann@hotmail.de>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "journal.h"
+
+#include "log.h"
+
+JournalWriter::JournalWriter()
+    : descriptor_(-1),
+      notifier_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+      durability_(DURABILITY_FLUSH),
+      codec_(COMPRESSION_NONE),
+      stop_(false),
+      submitted_(0),
+      committed_(0),
+      queue_depth_(0),
+      batches_(0),
+      latency_total_(0),
+      latency_maximum_(0) {
+  if (notifier_ == -1) {
+    throw std::runtime_error("journal: could not create notifier");
+  }
+}
+
+JournalWriter::~JournalWriter() {
+  Close();
+  close(notifier_);
+}
+
+void JournalWriter::Open(const std::string &filepath,
+                         DatabaseDurability durability,
+                         CompressionCodec codec) {
+  if (IsOpen()) {
+    throw std::runtime_error("journal: writer already open");
+  }
+  durability_ = durability;
+  codec_ = codec;
+  uint8_t flags = kEncodingFlagFramed;
+  if (codec_ != COMPRESSION_NONE) {
+    flags |= kEncodingFlagCompressed;
+  }
+  descriptor_ = open(filepath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (descriptor_ == -1) {
+    throw std::runtime_error("journal: could not open file");
+  }
+  std::ostringstream header;
+  if (encoding::WriteHeader(header, flags, codec_) == std::string::npos ||
+      write(descriptor_, header.str().data(), header.str().length()) !=
+          (ssize_t)header.str().length()) {
+    throw std::runtime_error("journal: could not write file header");
+  }
+  encoding::SetVersion(stream_, encoding::GetVersion(header));
+  if (durability_ == DURABILITY_SYNC) {
+    std::string directory = kStringDot;
+    size_t position = filepath.rfind(kStringSlash);
+    if (position != std::string::npos) {
+      directory = filepath.substr(0, position + 1);
+    }
+    int descriptor = open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fdatasync(descriptor_) != 0 || descriptor == -1 ||
+        fsync(descriptor) != 0) {
+      LOG_INFO("journal: could not sync file creation");
+    }
+    if (descriptor != -1) {
+      close(descriptor);
+    }
+  }
+  sigset_t blocked;
+  sigset_t previous;
+  sigfillset(&blocked);
+  pthread_sigmask(SIG_SETMASK, &blocked, &previous);
+  stop_ = false;
+  worker_ = std::thread([this] { Run(); });
+  pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+}
+
+void JournalWriter::Close() {
+  if (!IsOpen()) {
+    return;
+  }
+  Submit();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  condition_.notify_one();
+  worker_.join();
+  close(descriptor_);
+  descriptor_ = -1;
+}
+
+bool JournalWriter::IsOpen() const { return descriptor_ != -1; }
+
+std::ostream &JournalWriter::GetStream() { return stream_; }
+
+size_t JournalWriter::GetBuffered() { return stream_.tellp(); }
+
+uint64_t JournalWriter::Submit() {
+  std::string buffer = std::move(stream_).str();
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!buffer.empty()) {
+    queue_depth_ += buffer.length();
+    submissions_.push_back(buffer.length());
+    if (pending_.empty()) {
+      pending_.swap(buffer);
+    } else {
+      pending_.append(buffer);
+    }
+    submitted_++;
+    condition_.notify_one();
+  }
+  buffer.clear();
+  stream_.str(std::move(buffer));
+  return submitted_;
+}
+
+uint64_t JournalWriter::GetCommitted() const { return committed_; }
+
+int JournalWriter::GetNotifier() const { return notifier_; }
+
+size_t JournalWriter::GetQueueDepth() const { return queue_depth_; }
+
+uint64_t JournalWriter::GetBatches() const { return batches_; }
+
+uint64_t JournalWriter::GetLatencyAverage() const {
+  return batches_ == 0 ? 0 : latency_total_ / batches_;
+}
+
+uint64_t JournalWriter::GetLatencyMaximum() const { return latency_maximum_; }
+
+static void AppendBlock(CompressionCodec codec, const char *data,
+                        size_t length, std::string &output) {
+  size_t position = output.length();
+  output.append(kJournalFrameHeaderSize, kCharNullTerminator);
+  compression::Compress(codec, data, length, output);
+  uint32_t size = output.length() - position - kJournalFrameHeaderSize;
+  uint32_t checksum =
+      encoding::Crc32c(&output[position + kJournalFrameHeaderSize], size);
+  memcpy(&output[position], &size, sizeof(uint32_t));
+  memcpy(&output[position + sizeof(uint32_t)], &checksum, sizeof(uint32_t));
+}
+
+void JournalWriter::Run() {
+  std::string buffer;
+  std::string block;
+  std::vector<size_t> submissions;
+  size_t begin;
+  size_t end;
+  uint64_t ticket;
+  uint64_t latency;
+  size_t offset;
+  ssize_t bytes;
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    condition_.wait(lock, [this] { return stop_ || !pending_.empty(); });
+    if (pending_.empty()) {
+      return;
+    }
+    buffer.swap(pending_);
+    submissions.swap(submissions_);
+    ticket = submitted_;
+    lock.unlock();
+    auto start = std::chrono::steady_clock::now();
+    if (codec_ != COMPRESSION_NONE) {
+      block.clear();
+      begin = 0;
+      end = 0;
+      for (size_t idx = 0; idx < submissions.size(); idx++) {
+        end += submissions[idx];
+        if (idx + 1 < submissions.size() &&
+            end - begin + submissions[idx + 1] <= kJournalBlockLimit) {
+          continue;
+        }
+        if (end - begin > kCompressionBlockMaximum) {
+          LOG_INFO("journal: submission exceeds compression block limit");
+          abort();
+        }
+        AppendBlock(codec_, buffer.data() + begin, end - begin, block);
+        begin = end;
+      }
+    }
+    const std::string &output = codec_ != COMPRESSION_NONE ? block : buffer;
+    for (offset = 0; offset < output.length(); offset += bytes) {
+      bytes = write(descriptor_, output.data() + offset,
+                    output.length() - offset);
+      if (bytes == -1 && errno == EINTR) {
+        bytes = 0;
+      } else if (bytes == -1) {
+        LOG_INFO("journal: could not write: " + std::string(strerror(errno)));
+        abort();
+      }
+    }
+    if (durability_ == DURABILITY_SYNC && fdatasync(descriptor_) != 0) {
+      LOG_INFO("journal: could not sync: " + std::string(strerror(errno)));
+      abort();
+    }
+    latency = std::chrono::duration_cast<std::chrono::microseconds>(
+                  std::chrono::steady_clock::now() - start)
+                  .count();
+    queue_depth_ -= buffer.length();
+    latency_total_ += latency;
+    if (latency > latency_maximum_) {
+      latency_maximum_ = latency;
+    }
+    batches_++;
+    buffer.clear();
+    submissions.clear();
+    committed_ = ticket;
+    eventfd_write(notifier_, 1);
+    lock.lock();
+  }
+}
+
+namespace journal {
+
+static bool FrameFollows(const char *data, size_t length) {
+  uint32_t size;
+  uint32_t checksum;
+  for (size_t offset = 0; offset + kJournalFrameHeaderSize < length;
+       offset++) {
+    size_t position = offset;
+    while (position + kJournalFrameHeaderSize < length) {
+      memcpy(&size, data + position, sizeof(uint32_t));
+      memcpy(&checksum, data + position + sizeof(uint32_t), sizeof(uint32_t));
+      if (size == 0 || size > length - position - kJournalFrameHeaderSize ||
+          encoding::Crc32c(data + position + kJournalFrameHeaderSize, size) !=
+              checksum) {
+        break;
+      }
+      position += kJournalFrameHeaderSize + size;
+    }
+    if (position == length) {
+      return true;
+    }
+  }
+  return false;
+}
+
+JournalFrameStatus ReadFrame(EncodingReader &reader, EncodingReader &payload) {
+  if (reader.Remaining() == 0) {
+    return FRAME_END;
+  }
+  uint32_t length;
+  uint32_t checksum;
+  if (reader.Remaining() < kJournalFrameHeaderSize) {
+    return FRAME_TORN;
+  }
+  memcpy(&length, reader.Current(), sizeof(uint32_t));
+  memcpy(&checksum, reader.Current() + sizeof(uint32_t), sizeof(uint32_t));
+  if (length == 0 || reader.Remaining() - kJournalFrameHeaderSize < length) {
+    return FrameFollows(reader.Current() + kJournalFrameHeaderSize,
+                        reader.Remaining() - kJournalFrameHeaderSize)
+               ? FRAME_CORRUPTED
+               : FRAME_TORN;
+  }
+  const char *data = reader.Current() + kJournalFrameHeaderSize;
+  if (encoding::Crc32c(data, length) != checksum) {
+    return reader.Remaining() == kJournalFrameHeaderSize + length
+               ? FRAME_TORN
+               : FRAME_CORRUPTED;
+  }
+  reader.Take(kJournalFrameHeaderSize + length);
+  payload = EncodingReader(data, length);
+  payload.SetVersion(reader.GetVersion());
+  return FRAME_VALID;
+}
+
+}  // namespace journal
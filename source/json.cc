@@ -17,11 +17,15 @@ limitations under the License. */
 namespace json {
 
 bool IsArray(const JsonValue &value) {
-  return value.type() == typeid(JsonArray);
+  return value.type() == typeid(JsonArray) ||
+         (value.type() == typeid(JsonLazy) &&
+          std::any_cast<const JsonLazy &>(value).IsArray());
 }
 
 bool IsObject(const JsonValue &value) {
-  return value.type() == typeid(JsonObject);
+  return value.type() == typeid(JsonObject) ||
+         (value.type() == typeid(JsonLazy) &&
+          std::any_cast<const JsonLazy &>(value).IsObject());
 }
 
 bool IsBoolean(const JsonValue &value) {
@@ -37,70 +41,964 @@ bool IsFloat(const JsonValue &value) {
 }
 
 bool IsString(const JsonValue &value) {
-  return value.type() == typeid(JsonString);
+  return value.type() == typeid(JsonString) ||
+         value.type() == typeid(JsonSymbol);
+}
+
+const JsonString &GetString(const JsonValue &value) {
+  const JsonSymbol *symbol = std::any_cast<JsonSymbol>(&value);
+  if (symbol != nullptr) {
+    return symbol->GetString();
+  }
+  return std::any_cast<const JsonString &>(value);
+}
+
+static bool IsDigit(char character) {
+  return character >= kCharZero && character <= kCharNine;
+}
+
+bool ParseNumber(const std::string &source, size_t &offset,
+                 JsonNumber &number) {
+  const char *begin = source.data() + offset;
+  const char *end = source.data() + source.length();
+  const char *cursor = begin;
+  bool floating = false;
+  if (cursor < end && *cursor == kCharMinus) {
+    cursor++;
+  }
+  if (cursor == end || !IsDigit(*cursor)) {
+    return false;
+  }
+  if (*cursor == kCharZero) {
+    cursor++;
+  } else {
+    while (cursor < end && IsDigit(*cursor)) {
+      cursor++;
+    }
+  }
+  if (cursor < end && *cursor == kCharDot) {
+    floating = true;
+    cursor++;
+    if (cursor == end || !IsDigit(*cursor)) {
+      return false;
+    }
+    while (cursor < end && IsDigit(*cursor)) {
+      cursor++;
+    }
+  }
+  if (cursor < end &&
+      (*cursor == kCharExponentLower || *cursor == kCharExponentUpper)) {
+    floating = true;
+    cursor++;
+    if (cursor < end && (*cursor == kCharPlus || *cursor == kCharMinus)) {
+      cursor++;
+    }
+    if (cursor == end || !IsDigit(*cursor)) {
+      return false;
+    }
+    while (cursor < end && IsDigit(*cursor)) {
+      cursor++;
+    }
+  }
+  if (!floating) {
+    JsonInteger integer;
+    std::from_chars_result result = std::from_chars(begin, cursor, integer);
+    if (result.ec == std::errc()) {
+      number = integer;
+      offset += cursor - begin;
+      return true;
+    }
+    if (result.ec != std::errc::result_out_of_range) {
+      return false;
+    }
+  }
+  JsonFloat value;
+  std::from_chars_result result = std::from_chars(begin, cursor, value);
+  if (result.ec != std::errc() || result.ptr != cursor) {
+    return false;
+  }
+  number = value;
+  offset += cursor - begin;
+  return true;
+}
+
+static bool SkipLiteral(const std::string &source, size_t &offset,
+                        const std::string &literal) {
+  if (source.compare(offset, literal.length(), literal) != 0) {
+    return false;
+  }
+  offset += literal.length();
+  return true;
+}
+
+bool Skip(const std::string &source, size_t &offset) {
+  JsonNumber number;
+  size_t position;
+  if (!StringExpect(source, kStringEmpty, offset)) {
+    return false;
+  }
+  switch (source[offset]) {
+    case kCharN:
+      return SkipLiteral(source, offset, kJsonNull);
+    case kCharT:
+      return SkipLiteral(source, offset, kJsonTrue);
+    case kCharF:
+      return SkipLiteral(source, offset, kJsonFalse);
+    case kCharDoubleQuote:
+      position = source.find(kCharDoubleQuote, offset + 1);
+      if (position == std::string::npos) {
+        return false;
+      }
+      offset = position + 1;
+      return true;
+    case kCharCurlyBracketOpen:
+      offset++;
+      if (StringExpect(source, kStringCurlyBracketClose, offset)) {
+        return true;
+      }
+      for (;;) {
+        if (!StringExpect(source, kStringDoubleQuote, offset)) {
+          return false;
+        }
+        position = source.find(kCharDoubleQuote, offset);
+        if (position == std::string::npos) {
+          return false;
+        }
+        offset = position + 1;
+        if (!StringExpect(source, kStringColon, offset) ||
+            !Skip(source, offset) ||
+            !StringExpect(source, kStringEmpty, offset)) {
+          return false;
+        }
+        if (source[offset] == kCharComma) {
+          offset++;
+        } else if (source[offset] == kCharCurlyBracketClose) {
+          offset++;
+          return true;
+        } else {
+          return false;
+        }
+      }
+    case kCharSquareBracketOpen:
+      offset++;
+      if (StringExpect(source, kStringSquareBracketClose, offset)) {
+        return true;
+      }
+      for (;;) {
+        if (!Skip(source, offset) ||
+            !StringExpect(source, kStringEmpty, offset)) {
+          return false;
+        }
+        if (source[offset] == kCharComma) {
+          offset++;
+        } else if (source[offset] == kCharSquareBracketClose) {
+          offset++;
+          return true;
+        } else {
+          return false;
+        }
+      }
+    default:
+      return ParseNumber(source, offset, number);
+  }
+}
+
+static JsonObject ValueObject(const JsonValue &value) {
+  if (value.type() == typeid(JsonLazy)) {
+    return std::any_cast<const JsonLazy &>(value).GetObject();
+  }
+  return std::any_cast<JsonObject>(value);
+}
+
+static JsonArray ValueArray(const JsonValue &value) {
+  if (value.type() == typeid(JsonLazy)) {
+    return std::any_cast<const JsonLazy &>(value).GetArray();
+  }
+  return std::any_cast<JsonArray>(value);
+}
+
+static JsonValue Materialize(const JsonValue &value) {
+  if (value.type() == typeid(JsonSymbol)) {
+    return std::any_cast<const JsonSymbol &>(value).GetString();
+  } else if (value.type() != typeid(JsonLazy)) {
+    return value;
+  }
+  const JsonLazy &lazy = std::any_cast<const JsonLazy &>(value);
+  if (lazy.IsObject()) {
+    return lazy.GetObject();
+  }
+  return lazy.GetArray();
+}
+
+static uint64_t HashMix(uint64_t value) {
+  value ^= value >> 33;
+  value *= 0xff51afd7ed558ccdULL;
+  value ^= value >> 33;
+  value *= 0xc4ceb9fe1a85ec53ULL;
+  value ^= value >> 33;
+  return value;
+}
+
+static uint64_t HashInteger(JsonInteger value) {
+  return HashMix((uint64_t)value ^ kJsonHashInteger);
+}
+
+static uint64_t HashFloat(JsonFloat value) {
+  uint64_t bits;
+  if (value == 0) {
+    value = 0;
+  }
+  std::memcpy(&bits, &value, sizeof(bits));
+  return HashMix(bits ^ kJsonHashFloat);
+}
+
+static uint64_t HashString(const char *data, size_t length) {
+  uint64_t result = kJsonHashString ^ (length * kJsonHashMultiplier);
+  uint64_t word;
+  size_t i = 0;
+  for (; i + sizeof(word) <= length; i += sizeof(word)) {
+    std::memcpy(&word, data + i, sizeof(word));
+    result = (result ^ HashMix(word)) * kJsonHashMultiplier;
+  }
+  if (i < length) {
+    word = 0;
+    std::memcpy(&word, data + i, length - i);
+    result = (result ^ HashMix(word)) * kJsonHashMultiplier;
+  }
+  return HashMix(result);
+}
+
+static uint64_t HashCombine(uint64_t seed, uint64_t value) {
+  return HashMix(seed * kJsonHashMultiplier + value);
+}
+
+uint64_t Hash(const JsonValue &value) {
+  if (!value.has_value()) {
+    return HashMix(kJsonHashNull);
+  } else if (value.type() == typeid(JsonBoolean)) {
+    return HashMix(kJsonHashBoolean + std::any_cast<JsonBoolean>(value));
+  } else if (value.type() == typeid(JsonInteger)) {
+    return HashInteger(std::any_cast<JsonInteger>(value));
+  } else if (value.type() == typeid(JsonFloat)) {
+    return HashFloat(std::any_cast<JsonFloat>(value));
+  } else if (IsString(value)) {
+    const JsonString &string = GetString(value);
+    return HashString(string.data(), string.length());
+  } else if (value.type() == typeid(JsonObject)) {
+    return std::any_cast<const JsonObject &>(value).Hash();
+  } else if (value.type() == typeid(JsonArray)) {
+    return std::any_cast<const JsonArray &>(value).Hash();
+  } else if (value.type() == typeid(JsonLazy)) {
+    const JsonLazy &lazy = std::any_cast<const JsonLazy &>(value);
+    return lazy.IsObject() ? lazy.GetObject().Hash() : lazy.GetArray().Hash();
+  }
+  throw std::runtime_error("incompatible json type");
+}
+
+bool Equal(const JsonValue &value, const JsonValue &other) {
+  if (value.type() == other.type()) {
+    if (!value.has_value()) {
+      return true;
+    } else if (value.type() == typeid(JsonBoolean)) {
+      return std::any_cast<JsonBoolean>(value) ==
+             std::any_cast<JsonBoolean>(other);
+    } else if (value.type() == typeid(JsonInteger)) {
+      return std::any_cast<JsonInteger>(value) ==
+             std::any_cast<JsonInteger>(other);
+    } else if (value.type() == typeid(JsonFloat)) {
+      return std::any_cast<JsonFloat>(value) == std::any_cast<JsonFloat>(other);
+    } else if (value.type() == typeid(JsonSymbol)) {
+      return std::any_cast<const JsonSymbol &>(value) ==
+             std::any_cast<const JsonSymbol &>(other);
+    } else if (value.type() == typeid(JsonString)) {
+      return std::any_cast<const JsonString &>(value) ==
+             std::any_cast<const JsonString &>(other);
+    } else if (value.type() == typeid(JsonObject)) {
+      return std::any_cast<const JsonObject &>(value) ==
+             std::any_cast<const JsonObject &>(other);
+    } else if (value.type() == typeid(JsonArray)) {
+      return std::any_cast<const JsonArray &>(value) ==
+             std::any_cast<const JsonArray &>(other);
+    } else if (value.type() == typeid(JsonLazy) &&
+               std::any_cast<const JsonLazy &>(value).GetSource() ==
+                   std::any_cast<const JsonLazy &>(other).GetSource()) {
+      return true;
+    }
+  }
+  if (IsString(value) && IsString(other)) {
+    return GetString(value) == GetString(other);
+  } else if (value.type() == typeid(JsonObject) && IsObject(other)) {
+    return std::any_cast<const JsonObject &>(value) == ValueObject(other);
+  } else if (other.type() == typeid(JsonObject) && IsObject(value)) {
+    return ValueObject(value) == std::any_cast<const JsonObject &>(other);
+  } else if (value.type() == typeid(JsonArray) && IsArray(other)) {
+    return std::any_cast<const JsonArray &>(value) == ValueArray(other);
+  } else if (other.type() == typeid(JsonArray) && IsArray(value)) {
+    return ValueArray(value) == std::any_cast<const JsonArray &>(other);
+  } else if (IsObject(value) && IsObject(other)) {
+    return ValueObject(value) == ValueObject(other);
+  } else if (IsArray(value) && IsArray(other)) {
+    return ValueArray(value) == ValueArray(other);
+  }
+  return false;
+}
+
+void WriteCanonical(const JsonValue &value, std::string &target) {
+  char buffer[kJsonNumberMaximumLength];
+  std::to_chars_result result;
+  if (!value.has_value()) {
+    target += kJsonNull;
+  } else if (value.type() == typeid(JsonBoolean)) {
+    target += std::any_cast<JsonBoolean>(value) ? kJsonTrue : kJsonFalse;
+  } else if (value.type() == typeid(JsonInteger)) {
+    result = std::to_chars(buffer, buffer + sizeof(buffer),
+                           std::any_cast<JsonInteger>(value));
+    target.append(buffer, result.ptr);
+  } else if (value.type() == typeid(JsonFloat)) {
+    result = std::to_chars(buffer, buffer + sizeof(buffer),
+                           std::any_cast<JsonFloat>(value));
+    target.append(buffer, result.ptr);
+  } else if (IsString(value)) {
+    target += kCharDoubleQuote;
+    target += GetString(value);
+    target += kCharDoubleQuote;
+  } else if (value.type() == typeid(JsonObject)) {
+    WriteCanonical(std::any_cast<const JsonObject &>(value), target);
+  } else if (value.type() == typeid(JsonArray)) {
+    WriteCanonical(std::any_cast<const JsonArray &>(value), target);
+  } else if (value.type() == typeid(JsonLazy)) {
+    const JsonLazy &lazy = std::any_cast<const JsonLazy &>(value);
+    if (lazy.IsObject()) {
+      WriteCanonical(lazy.GetObject(), target);
+    } else {
+      WriteCanonical(lazy.GetArray(), target);
+    }
+  } else {
+    throw std::runtime_error("incompatible json type");
+  }
 }
 
 }  // namespace json
 
-JsonObject::JsonObject() {}
+std::shared_mutex JsonShape::mutex_;
+
+std::atomic<size_t> JsonShape::count_ = 0;
+
+JsonShape::JsonShape() {}
+
+JsonShape::~JsonShape() {
+  if (!parent_) {
+    return;
+  }
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  auto lookup = parent_->transitions_.find(keys_.back());
+  if (lookup != parent_->transitions_.end() && lookup->second.expired()) {
+    parent_->transitions_.erase(lookup);
+  }
+  count_--;
+}
+
+size_t JsonShape::Size() const { return keys_.size(); }
+
+size_t JsonShape::Find(const std::string &key) const {
+  for (size_t i = 0; i < keys_.size(); i++) {
+    if (keys_[i] == key) {
+      return i;
+    }
+  }
+  return std::string::npos;
+}
+
+const std::string &JsonShape::Key(size_t index) const { return keys_[index]; }
+
+const std::vector<std::string> &JsonShape::Keys() const { return keys_; }
+
+std::shared_ptr<const JsonShape> JsonShape::Transition(
+    const std::shared_ptr<const JsonShape> &shape, const std::string &key) {
+  static const std::shared_ptr<const JsonShape> root(new JsonShape());
+  const std::shared_ptr<const JsonShape> &parent = shape ? shape : root;
+  {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto lookup = parent->transitions_.find(key);
+    if (lookup != parent->transitions_.end()) {
+      std::shared_ptr<const JsonShape> child = lookup->second.lock();
+      if (child) {
+        return child;
+      }
+    }
+  }
+  if (parent->keys_.size() >= kJsonShapeMaximumKeys ||
+      count_ >= kJsonShapeMaximumCount) {
+    return nullptr;
+  }
+  std::shared_ptr<JsonShape> child(new JsonShape());
+  child->keys_.reserve(parent->keys_.size() + 1);
+  child->keys_ = parent->keys_;
+  child->keys_.emplace_back(key);
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  std::weak_ptr<const JsonShape> &transition = parent->transitions_[key];
+  std::shared_ptr<const JsonShape> existing = transition.lock();
+  if (existing) {
+    return existing;
+  }
+  child->parent_ = parent;
+  transition = child;
+  count_++;
+  return child;
+}
+
+size_t JsonShape::Count() { return count_; }
+
+JsonDictionary::JsonDictionary() {}
+
+JsonDictionary::JsonDictionary(const JsonDictionary &dictionary)
+    : members_(dictionary.members_) {
+  if (dictionary.index_) {
+    index_ = std::make_unique<std::unordered_map<std::string, size_t>>(
+        *dictionary.index_);
+  }
+}
+
+JsonDictionary::~JsonDictionary() {}
+
+size_t JsonDictionary::Size() const { return members_.size(); }
+
+size_t JsonDictionary::Capacity() const { return members_.capacity(); }
+
+bool JsonDictionary::IsFlat() const { return !index_; }
 
-JsonObject::JsonObject(const JsonObject &object) { values_ = object.values_; }
+const std::string &JsonDictionary::Key(size_t index) const {
+  return members_[index].first;
+}
+
+const JsonValue &JsonDictionary::Value(size_t index) const {
+  return members_[index].second;
+}
+
+JsonValue &JsonDictionary::Value(size_t index) {
+  return members_[index].second;
+}
+
+size_t JsonDictionary::Find(const std::string &key) const {
+  if (index_) {
+    auto lookup = index_->find(key);
+    return lookup == index_->end() ? std::string::npos : lookup->second;
+  }
+  for (size_t i = 0; i < members_.size(); i++) {
+    if (members_[i].first == key) {
+      return i;
+    }
+  }
+  return std::string::npos;
+}
+
+bool JsonDictionary::Insert(const std::string &key, JsonValue &&value) {
+  if (Find(key) != std::string::npos) {
+    return false;
+  }
+  members_.emplace_back(key, std::move(value));
+  if (index_) {
+    index_->emplace(key, members_.size() - 1);
+  } else if (members_.size() > kJsonDictionaryFlatMaximum) {
+    index_ = std::make_unique<std::unordered_map<std::string, size_t>>();
+    index_->reserve(members_.size());
+    for (size_t i = 0; i < members_.size(); i++) {
+      index_->emplace(members_[i].first, i);
+    }
+  }
+  return true;
+}
+
+void JsonDictionary::Assign(size_t index, JsonValue &&value) {
+  members_[index].second = std::move(value);
+}
+
+void JsonDictionary::Erase(size_t index) {
+  if (index_) {
+    index_->erase(members_[index].first);
+  }
+  members_.erase(members_.begin() + index);
+  if (index_) {
+    for (size_t i = index; i < members_.size(); i++) {
+      (*index_)[members_[i].first] = i;
+    }
+  }
+}
+
+void JsonDictionary::Reserve(size_t size) { members_.reserve(size); }
+
+JsonLazy::JsonLazy() {}
 
-JsonObject::JsonObject(const std::string &source) { Parse(source); }
+JsonLazy::JsonLazy(const std::string &source) : source_(source) {}
+
+JsonLazy::JsonLazy(const std::string &source, size_t begin, size_t end) {
+  bool quoted = false;
+  source_.reserve(end - begin);
+  for (size_t i = begin; i < end; i++) {
+    if (source[i] == kCharDoubleQuote) {
+      quoted = !quoted;
+    } else if (!quoted && CharIsAnyOf(source[i], kStringWss)) {
+      continue;
+    }
+    source_ += source[i];
+  }
+}
+
+JsonLazy::~JsonLazy() {}
+
+bool JsonLazy::IsObject() const {
+  return !source_.empty() && source_[0] == kCharCurlyBracketOpen;
+}
+
+bool JsonLazy::IsArray() const {
+  return !source_.empty() && source_[0] == kCharSquareBracketOpen;
+}
+
+JsonObject JsonLazy::GetObject() const {
+  if (!IsObject()) {
+    throw std::bad_any_cast();
+  }
+  JsonObject object;
+  object.ParseLazy(source_);
+  return object;
+}
+
+JsonArray JsonLazy::GetArray() const {
+  if (!IsArray()) {
+    throw std::bad_any_cast();
+  }
+  JsonArray array;
+  array.ParseLazy(source_);
+  return array;
+}
+
+const std::string &JsonLazy::GetSource() const { return source_; }
+
+JsonSymbol::JsonSymbol(JsonSymbolEntry *entry) : entry_(entry) {
+  entry_->second++;
+}
+
+JsonSymbol::JsonSymbol(const JsonSymbol &symbol) : entry_(symbol.entry_) {
+  if (entry_ != nullptr) {
+    entry_->second++;
+  }
+}
+
+JsonSymbol::JsonSymbol(JsonSymbol &&symbol) noexcept : entry_(symbol.entry_) {
+  symbol.entry_ = nullptr;
+}
+
+JsonSymbol::~JsonSymbol() {
+  if (entry_ != nullptr) {
+    entry_->second--;
+  }
+}
+
+JsonSymbol &JsonSymbol::operator=(const JsonSymbol &symbol) {
+  if (symbol.entry_ != nullptr) {
+    symbol.entry_->second++;
+  }
+  if (entry_ != nullptr) {
+    entry_->second--;
+  }
+  entry_ = symbol.entry_;
+  return *this;
+}
+
+bool JsonSymbol::operator==(const JsonSymbol &other) const {
+  return entry_ == other.entry_;
+}
+
+bool JsonSymbol::operator!=(const JsonSymbol &other) const {
+  return entry_ != other.entry_;
+}
+
+const std::string &JsonSymbol::GetString() const { return entry_->first; }
+
+JsonStringPool::JsonStringPool() {}
+
+JsonStringPool::~JsonStringPool() {}
+
+size_t JsonStringPool::Size() const { return entries_.size(); }
+
+bool JsonStringPool::Intern(JsonValue &value) {
+  const JsonString *string = std::any_cast<JsonString>(&value);
+  if (string == nullptr || string->length() > kJsonSymbolMaximumLength) {
+    return false;
+  }
+  auto entry = entries_.find(*string);
+  if (entry == entries_.end()) {
+    if (candidates_.size() >= kJsonSymbolCandidateMaximum) {
+      candidates_.clear();
+    }
+    auto candidate = candidates_.emplace(*string, 0).first;
+    if (++candidate->second < kJsonSymbolThreshold) {
+      return false;
+    }
+    candidates_.erase(candidate);
+    entry = entries_
+                .emplace(std::piecewise_construct, std::forward_as_tuple(*string),
+                         std::forward_as_tuple(0))
+                .first;
+  }
+  value = JsonSymbol(&*entry);
+  return true;
+}
+
+size_t JsonStringPool::Purge() {
+  size_t count = 0;
+  for (auto it = entries_.begin(); it != entries_.end();) {
+    if (it->second == 0) {
+      it = entries_.erase(it);
+      count++;
+    } else {
+      it++;
+    }
+  }
+  return count;
+}
+
+uint64_t JsonStringPool::Memory() const {
+  uint64_t result = sizeof(JsonStringPool) +
+                    entries_.bucket_count() * sizeof(void *) +
+                    candidates_.bucket_count() * sizeof(void *);
+  for (const JsonSymbolEntry &entry : entries_) {
+    result += sizeof(JsonSymbolEntry) + 2 * sizeof(void *);
+    if (entry.first.capacity() >= sizeof(std::string)) {
+      result += entry.first.capacity() + 1;
+    }
+  }
+  for (const auto &candidate : candidates_) {
+    result += sizeof(candidate) + 2 * sizeof(void *);
+    if (candidate.first.capacity() >= sizeof(std::string)) {
+      result += candidate.first.capacity() + 1;
+    }
+  }
+  return result;
+}
+
+JsonStreamParser::JsonStreamParser()
+    : stage_(STREAM_OPEN), string_(false), count_(0) {}
+
+JsonStreamParser::~JsonStreamParser() {}
+
+void JsonStreamParser::Feed(const std::string &chunk) {
+  size_t begin = 0;
+  size_t position;
+  char character;
+  for (size_t i = 0; i < chunk.length(); i++) {
+    character = chunk[i];
+    switch (stage_) {
+      case STREAM_OPEN:
+        if (CharIsAnyOf(character, kStringWss)) {
+          break;
+        }
+        if (character != kCharSquareBracketOpen) {
+          Fail("json: stream is not an array");
+        }
+        stage_ = STREAM_FIRST;
+        break;
+      case STREAM_FIRST:
+        [[fallthrough]];
+      case STREAM_VALUE:
+        if (CharIsAnyOf(character, kStringWss)) {
+          break;
+        }
+        if (character == kCharSquareBracketClose && stage_ == STREAM_FIRST) {
+          stage_ = STREAM_CLOSED;
+          break;
+        }
+        if (character == kCharComma ||
+            character == kCharSquareBracketClose ||
+            character == kCharCurlyBracketClose) {
+          Fail("json: stream element expected");
+        }
+        begin = i;
+        stage_ = STREAM_ELEMENT;
+        if (character == kCharDoubleQuote) {
+          string_ = true;
+        } else if (character == kCharCurlyBracketOpen ||
+                   character == kCharSquareBracketOpen) {
+          nesting_.push_back(character);
+        }
+        break;
+      case STREAM_ELEMENT:
+        if (string_) {
+          position = chunk.find(kCharDoubleQuote, i);
+          if (position == std::string::npos) {
+            i = chunk.length() - 1;
+            break;
+          }
+          i = position;
+          string_ = false;
+          if (nesting_.empty()) {
+            Emit(chunk, begin, i + 1);
+          }
+          break;
+        }
+        if (nesting_.empty()) {
+          if (CharIsAnyOf(character, kStringWss) || character == kCharComma ||
+              character == kCharSquareBracketClose) {
+            Emit(chunk, begin, i);
+            i--;
+          }
+          break;
+        }
+        position = chunk.find_first_of(kJsonStreamTokens, i);
+        if (position == std::string::npos) {
+          i = chunk.length() - 1;
+          break;
+        }
+        i = position;
+        character = chunk[i];
+        if (character == kCharDoubleQuote) {
+          string_ = true;
+        } else if (character == kCharCurlyBracketOpen ||
+                   character == kCharSquareBracketOpen) {
+          nesting_.push_back(character);
+        } else if (character == kCharCurlyBracketClose ||
+                   character == kCharSquareBracketClose) {
+          if (nesting_.back() != (character == kCharCurlyBracketClose
+                                      ? kCharCurlyBracketOpen
+                                      : kCharSquareBracketOpen)) {
+            Fail("json: stream element is malformed");
+          }
+          nesting_.pop_back();
+          if (nesting_.empty()) {
+            Emit(chunk, begin, i + 1);
+          }
+        }
+        break;
+      case STREAM_SEPARATOR:
+        if (CharIsAnyOf(character, kStringWss)) {
+          break;
+        }
+        if (character == kCharComma) {
+          stage_ = STREAM_VALUE;
+        } else if (character == kCharSquareBracketClose) {
+          stage_ = STREAM_CLOSED;
+        } else {
+          Fail("json: stream separator expected");
+        }
+        break;
+      case STREAM_CLOSED:
+        if (!CharIsAnyOf(character, kStringWss)) {
+          Fail("json: stream continues after array");
+        }
+        break;
+      default:
+        Fail("json: stream failed");
+    }
+  }
+  if (stage_ == STREAM_ELEMENT) {
+    element_.append(chunk, begin, std::string::npos);
+  }
+}
+
+bool JsonStreamParser::Next(std::string &element) {
+  if (elements_.empty()) {
+    return false;
+  }
+  element = std::move(elements_.front());
+  elements_.pop_front();
+  return true;
+}
+
+bool JsonStreamParser::IsComplete() const { return stage_ == STREAM_CLOSED; }
+
+size_t JsonStreamParser::Count() const { return count_; }
+
+void JsonStreamParser::Emit(const std::string &chunk, size_t begin,
+                            size_t end) {
+  element_.append(chunk, begin, end - begin);
+  elements_.push_back(std::move(element_));
+  element_.clear();
+  count_++;
+  stage_ = STREAM_SEPARATOR;
+}
+
+void JsonStreamParser::Fail(const std::string &message) {
+  stage_ = STREAM_FAILED;
+  element_.clear();
+  nesting_.clear();
+  throw std::runtime_error(message);
+}
+
+JsonObject::JsonObject() : hash_(0) {}
+
+JsonObject::JsonObject(const JsonObject &object)
+    : shape_(object.shape_), slots_(object.slots_), hash_(object.hash_) {
+  if (object.dictionary_) {
+    dictionary_ = std::make_unique<JsonDictionary>(*object.dictionary_);
+  }
+}
+
+JsonObject::JsonObject(JsonObject &&object)
+    : shape_(std::move(object.shape_)),
+      slots_(std::move(object.slots_)),
+      dictionary_(std::move(object.dictionary_)),
+      hash_(object.hash_) {}
+
+JsonObject::JsonObject(const std::string &source) : hash_(0) {
+  Parse(source);
+}
 
 JsonObject::~JsonObject() {}
 
-bool JsonObject::Has(const std::string &key) const {
-  return values_.find(key) != values_.end();
+JsonObject &JsonObject::operator=(const JsonObject &object) {
+  if (this != &object) {
+    shape_ = object.shape_;
+    slots_ = object.slots_;
+    hash_ = object.hash_;
+    if (object.dictionary_) {
+      dictionary_ = std::make_unique<JsonDictionary>(*object.dictionary_);
+    } else {
+      dictionary_.reset();
+    }
+  }
+  return *this;
+}
+
+JsonObject &JsonObject::operator=(JsonObject &&object) {
+  if (this != &object) {
+    shape_ = std::move(object.shape_);
+    slots_ = std::move(object.slots_);
+    dictionary_ = std::move(object.dictionary_);
+    hash_ = object.hash_;
+  }
+  return *this;
+}
+
+bool JsonObject::operator==(const JsonObject &other) const {
+  if (this == &other) {
+    return true;
+  }
+  if (Size() != other.Size() ||
+      (hash_ != 0 && other.hash_ != 0 && hash_ != other.hash_)) {
+    return false;
+  }
+  const JsonValue *value;
+  if (dictionary_) {
+    for (size_t i = 0; i < dictionary_->Size(); i++) {
+      value = other.Lookup(dictionary_->Key(i));
+      if (value == nullptr || !json::Equal(dictionary_->Value(i), *value)) {
+        return false;
+      }
+    }
+    return true;
+  }
+  for (size_t i = 0; i < slots_.size(); i++) {
+    value = shape_ == other.shape_ ? &other.slots_[i]
+                                   : other.Lookup(shape_->Key(i));
+    if (value == nullptr || !json::Equal(slots_[i], *value)) {
+      return false;
+    }
+  }
+  return true;
 }
 
-void JsonObject::PutNull(const std::string &key) {
-  static const JsonValue null = {};
-  values_.insert(std::make_pair(key, null));
+bool JsonObject::operator!=(const JsonObject &other) const {
+  return !(*this == other);
 }
 
+bool JsonObject::Has(const std::string &key) const {
+  if (dictionary_) {
+    return dictionary_->Find(key) != std::string::npos;
+  }
+  return shape_ && shape_->Find(key) != std::string::npos;
+}
+
+void JsonObject::PutNull(const std::string &key) { Put(key, JsonValue()); }
+
 void JsonObject::PutBoolean(const std::string &key, JsonBoolean value) {
-  values_.insert(std::make_pair(key, value));
+  Put(key, value);
 }
 
 void JsonObject::PutInteger(const std::string &key, JsonInteger value) {
-  values_.insert(std::make_pair(key, value));
+  Put(key, value);
 }
 
 void JsonObject::PutFloat(const std::string &key, JsonFloat value) {
-  values_.insert(std::make_pair(key, value));
+  Put(key, value);
 }
 
 void JsonObject::PutString(const std::string &key, const JsonString &value) {
-  values_.insert(std::make_pair(key, value));
+  Put(key, value);
 }
 
 void JsonObject::PutObject(const std::string &key, const JsonObject &value) {
-  values_.insert(std::make_pair(key, value));
+  Put(key, value);
 }
 
 void JsonObject::PutArray(const std::string &key, const JsonArray &value) {
-  values_.insert(std::make_pair(key, value));
+  Put(key, value);
+}
+
+bool JsonObject::Erase(const std::string &key) {
+  size_t index;
+  hash_ = 0;
+  if (dictionary_) {
+    index = dictionary_->Find(key);
+    if (index == std::string::npos) {
+      return false;
+    }
+    dictionary_->Erase(index);
+    return true;
+  }
+  index = shape_ ? shape_->Find(key) : std::string::npos;
+  if (index == std::string::npos) {
+    return false;
+  }
+  std::shared_ptr<const JsonShape> shape = std::move(shape_);
+  std::vector<JsonValue> slots = std::move(slots_);
+  shape_.reset();
+  slots_.clear();
+  slots_.reserve(slots.size() - 1);
+  for (size_t i = 0; i < slots.size(); i++) {
+    if (i != index) {
+      Put(shape->Key(i), std::move(slots[i]));
+    }
+  }
+  return true;
+}
+
+void JsonObject::Patch(const JsonObject &patch) {
+  for (const std::string &key : patch.Keys()) {
+    const JsonValue &value = patch.At(key);
+    if (!value.has_value()) {
+      Erase(key);
+    } else if (json::IsObject(value)) {
+      JsonObject object;
+      if (Has(key) && IsObject(key)) {
+        object = GetObject(key);
+      }
+      object.Patch(json::ValueObject(value));
+      Set(key, JsonValue(std::move(object)));
+    } else {
+      Set(key, JsonValue(value));
+    }
+  }
 }
 
 JsonValue JsonObject::GetValue(const std::string &key) const {
-  return values_.at(key);
+  return json::Materialize(At(key));
 }
 
 JsonBoolean JsonObject::GetBoolean(const std::string &key) const {
-  return std::any_cast<JsonBoolean>(values_.at(key));
+  return std::any_cast<JsonBoolean>(At(key));
 }
 
 JsonInteger JsonObject::GetInteger(const std::string &key) const {
-  return std::any_cast<JsonInteger>(values_.at(key));
+  return std::any_cast<JsonInteger>(At(key));
 }
 
 JsonFloat JsonObject::GetFloat(const std::string &key) const {
 	JsonFloat value;
-	if (values_.at(key).type() == typeid(JsonFloat)) {
-		value = std::any_cast<JsonFloat>(values_.at(key));
-	} else if (values_.at(key).type() == typeid(JsonInteger)) {
-		value = (JsonFloat)std::any_cast<JsonInteger>(values_.at(key));
+	const JsonValue &any = At(key);
+	if (any.type() == typeid(JsonFloat)) {
+		value = std::any_cast<JsonFloat>(any);
+	} else if (any.type() == typeid(JsonInteger)) {
+		value = (JsonFloat)std::any_cast<JsonInteger>(any);
 	} else {
 		throw std::runtime_error("invalid type");
 	}
@@ -108,65 +1006,134 @@ JsonFloat JsonObject::GetFloat(const std::string &key) const {
 }
 
 JsonString JsonObject::GetString(const std::string &key) const {
-  return std::any_cast<JsonString>(values_.at(key));
+  return json::GetString(At(key));
 }
 
 JsonObject JsonObject::GetObject(const std::string &key) const {
-  return std::any_cast<JsonObject>(values_.at(key));
+  return json::ValueObject(At(key));
 }
 
 JsonArray JsonObject::GetArray(const std::string &key) const {
-  return std::any_cast<JsonArray>(values_.at(key));
+  return json::ValueArray(At(key));
 }
 
 bool JsonObject::IsNull(const std::string &key) const {
-  return !values_.at(key).has_value();
+  return !At(key).has_value();
 }
 
 bool JsonObject::IsBoolean(const std::string &key) const {
-  return json::IsBoolean(values_.at(key));
+  return json::IsBoolean(At(key));
 }
 
 bool JsonObject::IsInteger(const std::string &key) const {
-  return json::IsInteger(values_.at(key));
+  return json::IsInteger(At(key));
 }
 
 bool JsonObject::IsFloat(const std::string &key) const {
-  return json::IsFloat(values_.at(key));
+  return json::IsFloat(At(key));
 }
 
 bool JsonObject::IsString(const std::string &key) const {
-  return json::IsString(values_.at(key));
+  return json::IsString(At(key));
+}
+
+bool JsonObject::IsObject(const std::string &key) const {
+  return json::IsObject(At(key));
+}
+
+bool JsonObject::IsArray(const std::string &key) const {
+  return json::IsArray(At(key));
+}
+
+std::vector<std::string> JsonObject::Keys() const {
+  std::vector<std::string> keys;
+  if (dictionary_) {
+    keys.reserve(dictionary_->Size());
+    for (size_t i = 0; i < dictionary_->Size(); i++) {
+      keys.emplace_back(dictionary_->Key(i));
+    }
+  } else if (shape_) {
+    keys = shape_->Keys();
+  }
+  return keys;
+}
+
+size_t JsonObject::Size() const {
+  return dictionary_ ? dictionary_->Size() : slots_.size();
+}
+
+bool JsonObject::IsShaped() const { return !dictionary_; }
+
+static void InternValue(JsonValue &value, JsonStringPool &pool) {
+  if (pool.Intern(value)) {
+    return;
+  }
+  if (value.type() == typeid(JsonLazy)) {
+    const std::string source = std::any_cast<JsonLazy &>(value).GetSource();
+    if (source[0] == kCharCurlyBracketOpen) {
+      value = JsonObject(source);
+    } else {
+      value = JsonArray(source);
+    }
+  }
+  JsonObject *object = std::any_cast<JsonObject>(&value);
+  if (object != nullptr) {
+    object->Intern(pool);
+    return;
+  }
+  JsonArray *array = std::any_cast<JsonArray>(&value);
+  if (array != nullptr) {
+    array->Intern(pool);
+  }
 }
 
-bool JsonObject::IsObject(const std::string &key) const {
-  return json::IsObject(values_.at(key));
+void JsonObject::Intern(JsonStringPool &pool) {
+  if (dictionary_) {
+    for (size_t i = 0; i < dictionary_->Size(); i++) {
+      InternValue(dictionary_->Value(i), pool);
+    }
+  } else {
+    for (JsonValue &value : slots_) {
+      InternValue(value, pool);
+    }
+  }
 }
 
-bool JsonObject::IsArray(const std::string &key) const {
-  return json::IsArray(values_.at(key));
+void JsonObject::Clear() {
+  hash_ = 0;
+  shape_.reset();
+  slots_.clear();
+  dictionary_.reset();
 }
 
-std::vector<std::string> JsonObject::Keys() const {
-  std::vector<std::string> keys;
-  keys.reserve(values_.size());
-  for (auto it = values_.begin(); it != values_.end(); it++) {
-    keys.emplace_back(it->first);
+uint64_t JsonObject::Hash() const {
+  if (hash_ != 0) {
+    return hash_;
   }
-  return keys;
+  uint64_t result = 0;
+  if (dictionary_) {
+    for (size_t i = 0; i < dictionary_->Size(); i++) {
+      const std::string &key = dictionary_->Key(i);
+      result += json::HashCombine(json::HashString(key.data(), key.length()),
+                                  json::Hash(dictionary_->Value(i)));
+    }
+  } else {
+    for (size_t i = 0; i < slots_.size(); i++) {
+      const std::string &key = shape_->Key(i);
+      result += json::HashCombine(json::HashString(key.data(), key.length()),
+                                  json::Hash(slots_[i]));
+    }
+  }
+  result = json::HashCombine(kJsonHashObject + Size(), result);
+  hash_ = result != 0 ? result : 1;
+  return hash_;
 }
 
-void JsonObject::Clear() { values_.clear(); }
-
 std::string JsonObject::String() const {
   std::stringstream ss;
   std::string sep = kStringEmpty;
   ss << kStringCurlyBracketOpen;
-  std::string key;
-  JsonValue value;
-  for (auto it = values_.begin(); it != values_.end(); it++) {
-    key = it->first;
-    value = it->second;
+  auto write = [&](const std::string &key, const JsonValue &value) {
     ss << sep;
     ss << kStringDoubleQuote << key << kStringDoubleQuote + kStringColon;
     if (value.type() == typeid(void)) {
@@ -181,29 +1148,115 @@ std::string JsonObject::String() const {
       ss << std::any_cast<JsonInteger>(value);
     } else if (value.type() == typeid(JsonFloat)) {
       ss << std::fixed << std::any_cast<JsonFloat>(value);
-    } else if (value.type() == typeid(JsonString)) {
-      ss << kStringDoubleQuote << std::any_cast<JsonString>(value)
-         << kStringDoubleQuote;
+    } else if (json::IsString(value)) {
+      ss << kStringDoubleQuote << json::GetString(value) << kStringDoubleQuote;
     } else if (value.type() == typeid(JsonObject)) {
-      ss << std::any_cast<JsonObject>(value).String();
+      ss << std::any_cast<const JsonObject &>(value).String();
     } else if (value.type() == typeid(JsonArray)) {
-      ss << std::any_cast<JsonArray>(value).String();
+      ss << std::any_cast<const JsonArray &>(value).String();
+    } else if (value.type() == typeid(JsonLazy)) {
+      ss << std::any_cast<const JsonLazy &>(value).GetSource();
     } else {
       throw std::runtime_error("incompatible json type");
     }
     sep = kStringComma;
+  };
+  if (dictionary_) {
+    for (size_t i = 0; i < dictionary_->Size(); i++) {
+      write(dictionary_->Key(i), dictionary_->Value(i));
+    }
+  } else {
+    for (size_t i = 0; i < slots_.size(); i++) {
+      write(shape_->Key(i), slots_[i]);
+    }
   }
   ss << kStringCurlyBracketClose;
   return ss.str();
 }
 
+std::string JsonObject::CanonicalString() const {
+  std::string result;
+  json::WriteCanonical(*this, result);
+  return result;
+}
+
+void JsonObject::Put(const std::string &key, JsonValue &&value) {
+  hash_ = 0;
+  if (!dictionary_) {
+    if (shape_ && shape_->Find(key) != std::string::npos) {
+      return;
+    }
+    std::shared_ptr<const JsonShape> shape = JsonShape::Transition(shape_, key);
+    if (shape) {
+      shape_ = std::move(shape);
+      slots_.emplace_back(std::move(value));
+      return;
+    }
+    MakeDictionary();
+  }
+  dictionary_->Insert(key, std::move(value));
+}
+
+void JsonObject::Set(const std::string &key, JsonValue &&value) {
+  size_t index;
+  hash_ = 0;
+  if (dictionary_) {
+    index = dictionary_->Find(key);
+    if (index != std::string::npos) {
+      dictionary_->Assign(index, std::move(value));
+      return;
+    }
+  } else {
+    index = shape_ ? shape_->Find(key) : std::string::npos;
+    if (index != std::string::npos) {
+      slots_[index] = std::move(value);
+      return;
+    }
+  }
+  Put(key, std::move(value));
+}
+
+const JsonValue &JsonObject::At(const std::string &key) const {
+  const JsonValue *value = Lookup(key);
+  if (value == nullptr) {
+    throw std::out_of_range("json: key not found");
+  }
+  return *value;
+}
+
+const JsonValue *JsonObject::Lookup(const std::string &key) const {
+  size_t index;
+  if (dictionary_) {
+    index = dictionary_->Find(key);
+    return index == std::string::npos ? nullptr : &dictionary_->Value(index);
+  }
+  index = shape_ ? shape_->Find(key) : std::string::npos;
+  return index == std::string::npos ? nullptr : &slots_[index];
+}
+
+void JsonObject::MakeDictionary() {
+  dictionary_ = std::make_unique<JsonDictionary>();
+  dictionary_->Reserve(slots_.size() + 1);
+  for (size_t i = 0; i < slots_.size(); i++) {
+    dictionary_->Insert(shape_->Key(i), std::move(slots_[i]));
+  }
+  shape_.reset();
+  std::vector<JsonValue>().swap(slots_);
+}
+
 void JsonObject::Parse(const std::string &source) {
   size_t offset = 0;
-  Parse(source, offset);
+  Parse(source, offset, false);
 }
 
-void JsonObject::Parse(const std::string &source, size_t &source_offset) {
-  values_.clear();
+void JsonObject::ParseLazy(const std::string &source) {
+  size_t offset = 0;
+  Parse(source, offset, true);
+}
+
+void JsonObject::Parse(const std::string &source, size_t &source_offset,
+                       bool lazy) {
+  Clear();
   size_t offset = source_offset;
   size_t position;
   const std::string kValueBorder =
@@ -212,12 +1265,15 @@ void JsonObject::Parse(const std::string &source, size_t &source_offset) {
   std::string value;
   JsonObject object;
   JsonArray array;
-  bool dot;
-  std::string text;
+  JsonNumber number;
   char border;
   if (!StringExpect(source, kStringCurlyBracketOpen, offset)) {
     throw std::runtime_error("json: initial bracket");
   }
+  if (StringExpect(source, kStringCurlyBracketClose, offset)) {
+    source_offset = offset;
+    return;
+  }
   for (;;) {
     if (!StringExpect(source, kStringDoubleQuote, offset)) {
       throw std::runtime_error("json: initial quote key");
@@ -299,38 +1355,39 @@ void JsonObject::Parse(const std::string &source, size_t &source_offset) {
       case kCharPlus:
         [[fallthrough]];
       case kCharMinus:
-        position = offset + 1;
-        dot = false;
-        while (position < source.length()) {
-          if (CharIsAnyOf(source[position], kValueBorder)) {
-            break;
-          }
-          if (source[position] == kCharDot) {
-            dot = true;
-          }
-          position++;
-        }
-        if (position == source.length()) {
+        if (!json::ParseNumber(source, offset, number) ||
+            offset == source.length() ||
+            !CharIsAnyOf(source[offset], kValueBorder)) {
           throw std::runtime_error("json: parse number value");
         }
-        text = source.substr(offset, position - offset);
-        try {
-          if (dot) {
-            PutFloat(key, std::atof(text.c_str()));
-          } else {
-            PutInteger(key, std::atoi(text.c_str()));
-          }
-        } catch (std::invalid_argument &) {
-          throw std::runtime_error("json: parse number value");
+        if (std::holds_alternative<JsonInteger>(number)) {
+          PutInteger(key, std::get<JsonInteger>(number));
+        } else {
+          PutFloat(key, std::get<JsonFloat>(number));
         }
-        offset = position;
         break;
       case kCharCurlyBracketOpen:
-        object.Parse(source, offset);
+        if (lazy) {
+          position = offset;
+          if (!json::Skip(source, offset)) {
+            throw std::runtime_error("json: parse object value");
+          }
+          Put(key, JsonLazy(source, position, offset));
+          break;
+        }
+        object.Parse(source, offset, false);
         PutObject(key, object);
         break;
       case kCharSquareBracketOpen:
-        array.Parse(source, offset);
+        if (lazy) {
+          position = offset;
+          if (!json::Skip(source, offset)) {
+            throw std::runtime_error("json: parse array value");
+          }
+          Put(key, JsonLazy(source, position, offset));
+          break;
+        }
+        array.Parse(source, offset, false);
         PutArray(key, array);
         break;
       default:
@@ -352,55 +1409,155 @@ void JsonObject::Parse(const std::string &source, size_t &source_offset) {
   source_offset = offset;
 }
 
+static const size_t kJsonArrayValues = 0;
+static const size_t kJsonArrayIntegers = 1;
+static const size_t kJsonArrayFloats = 2;
+static const size_t kJsonArrayStrings = 3;
+
 JsonArray::JsonArray() {}
 
 JsonArray::JsonArray(const JsonArray &array) { values_ = array.values_; }
 
+JsonArray::JsonArray(std::pmr::memory_resource *resource)
+    : values_(std::in_place_index<kJsonArrayValues>, resource) {}
+
 JsonArray::JsonArray(const std::string &source) { Parse(source); }
 
 JsonArray::~JsonArray() {}
 
-size_t JsonArray::Size() const { return values_.size(); }
+bool JsonArray::operator==(const JsonArray &other) const {
+  if (this == &other) {
+    return true;
+  }
+  if (Size() != other.Size()) {
+    return false;
+  }
+  if (values_.index() == other.values_.index()) {
+    switch (values_.index()) {
+      case kJsonArrayIntegers:
+        return std::get<kJsonArrayIntegers>(values_) ==
+               std::get<kJsonArrayIntegers>(other.values_);
+      case kJsonArrayFloats:
+        return std::get<kJsonArrayFloats>(values_) ==
+               std::get<kJsonArrayFloats>(other.values_);
+      case kJsonArrayStrings:
+        return std::get<kJsonArrayStrings>(values_) ==
+               std::get<kJsonArrayStrings>(other.values_);
+    }
+  }
+  for (size_t i = 0; i < Size(); i++) {
+    if (values_.index() == kJsonArrayValues &&
+        other.values_.index() == kJsonArrayValues) {
+      if (!json::Equal(std::get<kJsonArrayValues>(values_)[i],
+                       std::get<kJsonArrayValues>(other.values_)[i])) {
+        return false;
+      }
+    } else if (!json::Equal(GetValue(i), other.GetValue(i))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool JsonArray::operator!=(const JsonArray &other) const {
+  return !(*this == other);
+}
 
-void JsonArray::PutNull() {
-  static const JsonValue null = {};
-  values_.emplace_back(null);
+size_t JsonArray::Size() const {
+  switch (values_.index()) {
+    case kJsonArrayIntegers:
+      return std::get<kJsonArrayIntegers>(values_).size();
+    case kJsonArrayFloats:
+      return std::get<kJsonArrayFloats>(values_).size();
+    case kJsonArrayStrings:
+      return std::get<kJsonArrayStrings>(values_).size();
+    default:
+      return std::get<kJsonArrayValues>(values_).size();
+  }
 }
 
-void JsonArray::PutBoolean(JsonBoolean value) { values_.emplace_back(value); }
+void JsonArray::PutNull() { Generalize().emplace_back(); }
+
+void JsonArray::PutBoolean(JsonBoolean value) {
+  Generalize().emplace_back(value);
+}
 
-void JsonArray::PutInteger(JsonInteger value) { values_.emplace_back(value); }
+void JsonArray::PutInteger(JsonInteger value) {
+  if (Pack(kJsonArrayIntegers)) {
+    std::get<kJsonArrayIntegers>(values_).push_back(value);
+  } else {
+    Generalize().emplace_back(value);
+  }
+}
 
-void JsonArray::PutFloat(JsonFloat value) { values_.emplace_back(value); }
+void JsonArray::PutFloat(JsonFloat value) {
+  if (Pack(kJsonArrayFloats)) {
+    std::get<kJsonArrayFloats>(values_).push_back(value);
+  } else {
+    Generalize().emplace_back(value);
+  }
+}
 
 void JsonArray::PutString(const JsonString &value) {
-  values_.emplace_back(value);
+  if (Pack(kJsonArrayStrings)) {
+    std::get<kJsonArrayStrings>(values_).emplace_back(value.data(),
+                                                      value.length());
+  } else {
+    Generalize().emplace_back(value);
+  }
 }
 
 void JsonArray::PutObject(const JsonObject &value) {
-  values_.emplace_back(value);
+  Generalize().emplace_back(value);
 }
 
 void JsonArray::PutArray(const JsonArray &value) {
-  values_.emplace_back(value);
+  Generalize().emplace_back(value);
 }
 
-JsonValue JsonArray::GetValue(size_t index) const { return values_[index]; }
+JsonValue JsonArray::GetValue(size_t index) const {
+  switch (values_.index()) {
+    case kJsonArrayIntegers:
+      return std::get<kJsonArrayIntegers>(values_)[index];
+    case kJsonArrayFloats:
+      return std::get<kJsonArrayFloats>(values_)[index];
+    case kJsonArrayStrings:
+      return JsonString(std::get<kJsonArrayStrings>(values_)[index]);
+    default:
+      return json::Materialize(std::get<kJsonArrayValues>(values_)[index]);
+  }
+}
 
 JsonBoolean JsonArray::GetBoolean(size_t index) const {
-  return std::any_cast<JsonBoolean>(values_[index]);
+  if (values_.index() != kJsonArrayValues) {
+    throw std::bad_any_cast();
+  }
+  return std::any_cast<JsonBoolean>(std::get<kJsonArrayValues>(values_)[index]);
 }
 
 JsonInteger JsonArray::GetInteger(size_t index) const {
-  return std::any_cast<JsonInteger>(values_[index]);
+  if (values_.index() == kJsonArrayIntegers) {
+    return std::get<kJsonArrayIntegers>(values_)[index];
+  } else if (values_.index() != kJsonArrayValues) {
+    throw std::bad_any_cast();
+  }
+  return std::any_cast<JsonInteger>(std::get<kJsonArrayValues>(values_)[index]);
 }
 
 JsonFloat JsonArray::GetFloat(size_t index) const {
 	JsonFloat value;
-	if (values_[index].type() == typeid(JsonFloat)) {
-		value = std::any_cast<JsonFloat>(values_[index]);
-	} else if (values_[index].type() == typeid(JsonInteger)) {
-		value = (JsonFloat)std::any_cast<JsonInteger>(values_[index]);
+	if (values_.index() == kJsonArrayFloats) {
+		value = std::get<kJsonArrayFloats>(values_)[index];
+	} else if (values_.index() == kJsonArrayIntegers) {
+		value = (JsonFloat)std::get<kJsonArrayIntegers>(values_)[index];
+	} else if (values_.index() != kJsonArrayValues) {
+		throw std::runtime_error("invalid type");
+	} else if (IsFloat(index)) {
+		value = std::any_cast<JsonFloat>(
+		    std::get<kJsonArrayValues>(values_)[index]);
+	} else if (IsInteger(index)) {
+		value = (JsonFloat)std::any_cast<JsonInteger>(
+		    std::get<kJsonArrayValues>(values_)[index]);
 	} else {
 		throw std::runtime_error("invalid type");
 	}
@@ -408,52 +1565,141 @@ JsonFloat JsonArray::GetFloat(size_t index) const {
 }
 
 JsonString JsonArray::GetString(size_t index) const {
-  return std::any_cast<JsonString>(values_[index]);
+  if (values_.index() == kJsonArrayStrings) {
+    return JsonString(std::get<kJsonArrayStrings>(values_)[index]);
+  } else if (values_.index() != kJsonArrayValues) {
+    throw std::bad_any_cast();
+  }
+  return json::GetString(std::get<kJsonArrayValues>(values_)[index]);
 }
 
 JsonObject JsonArray::GetObject(size_t index) const {
-  return std::any_cast<JsonObject>(values_[index]);
+  if (values_.index() != kJsonArrayValues) {
+    throw std::bad_any_cast();
+  }
+  return json::ValueObject(std::get<kJsonArrayValues>(values_)[index]);
 }
 
 JsonArray JsonArray::GetArray(size_t index) const {
-  return std::any_cast<JsonArray>(values_[index]);
+  if (values_.index() != kJsonArrayValues) {
+    throw std::bad_any_cast();
+  }
+  return json::ValueArray(std::get<kJsonArrayValues>(values_)[index]);
 }
 
 bool JsonArray::IsNull(size_t index) const {
-  return !values_[index].has_value();
+  return values_.index() == kJsonArrayValues &&
+         !std::get<kJsonArrayValues>(values_)[index].has_value();
 }
 
 bool JsonArray::IsBoolean(size_t index) const {
-  return json::IsBoolean(values_[index]);
+  return values_.index() == kJsonArrayValues &&
+         json::IsBoolean(std::get<kJsonArrayValues>(values_)[index]);
 }
 
 bool JsonArray::IsInteger(size_t index) const {
-  return json::IsInteger(values_[index]);
+  if (values_.index() == kJsonArrayIntegers) {
+    return true;
+  }
+  return values_.index() == kJsonArrayValues &&
+         json::IsInteger(std::get<kJsonArrayValues>(values_)[index]);
 }
 
 bool JsonArray::IsFloat(size_t index) const {
-  return json::IsFloat(values_[index]);
+  if (values_.index() == kJsonArrayFloats) {
+    return true;
+  }
+  return values_.index() == kJsonArrayValues &&
+         json::IsFloat(std::get<kJsonArrayValues>(values_)[index]);
 }
 
 bool JsonArray::IsString(size_t index) const {
-  return json::IsString(values_[index]);
+  if (values_.index() == kJsonArrayStrings) {
+    return true;
+  }
+  return values_.index() == kJsonArrayValues &&
+         json::IsString(std::get<kJsonArrayValues>(values_)[index]);
 }
 
 bool JsonArray::IsObject(size_t index) const {
-  return json::IsObject(values_[index]);
+  return values_.index() == kJsonArrayValues &&
+         json::IsObject(std::get<kJsonArrayValues>(values_)[index]);
 }
 
 bool JsonArray::IsArray(size_t index) const {
-  return json::IsArray(values_[index]);
+  return values_.index() == kJsonArrayValues &&
+         json::IsArray(std::get<kJsonArrayValues>(values_)[index]);
+}
+
+bool JsonArray::IsPacked() const { return values_.index() != kJsonArrayValues; }
+
+void JsonArray::Intern(JsonStringPool &pool) {
+  if (values_.index() != kJsonArrayValues) {
+    return;
+  }
+  for (JsonValue &value : std::get<kJsonArrayValues>(values_)) {
+    InternValue(value, pool);
+  }
+}
+
+void JsonArray::Clear() {
+  values_.emplace<kJsonArrayValues>(Resource());
 }
 
-void JsonArray::Clear() { values_.clear(); }
+uint64_t JsonArray::Hash() const {
+  uint64_t result = kJsonHashArray;
+  switch (values_.index()) {
+    case kJsonArrayIntegers:
+      for (JsonInteger value : std::get<kJsonArrayIntegers>(values_)) {
+        result = json::HashCombine(result, json::HashInteger(value));
+      }
+      break;
+    case kJsonArrayFloats:
+      for (JsonFloat value : std::get<kJsonArrayFloats>(values_)) {
+        result = json::HashCombine(result, json::HashFloat(value));
+      }
+      break;
+    case kJsonArrayStrings:
+      for (const std::pmr::string &value :
+           std::get<kJsonArrayStrings>(values_)) {
+        result = json::HashCombine(
+            result, json::HashString(value.data(), value.length()));
+      }
+      break;
+    default:
+      for (const JsonValue &value : std::get<kJsonArrayValues>(values_)) {
+        result = json::HashCombine(result, json::Hash(value));
+      }
+  }
+  return json::HashCombine(result, Size());
+}
 
 std::string JsonArray::String() const {
   std::stringstream ss;
   std::string sep = kStringEmpty;
   ss << kStringSquareBracketOpen;
-  for (auto it = values_.begin(); it != values_.end(); it++) {
+  if (values_.index() == kJsonArrayIntegers) {
+    for (JsonInteger value : std::get<kJsonArrayIntegers>(values_)) {
+      ss << sep << value;
+      sep = kStringComma;
+    }
+  } else if (values_.index() == kJsonArrayFloats) {
+    for (JsonFloat value : std::get<kJsonArrayFloats>(values_)) {
+      ss << sep << std::fixed << value;
+      sep = kStringComma;
+    }
+  } else if (values_.index() == kJsonArrayStrings) {
+    for (const std::pmr::string &value : std::get<kJsonArrayStrings>(values_)) {
+      ss << sep << kStringDoubleQuote << value << kStringDoubleQuote;
+      sep = kStringComma;
+    }
+  }
+  if (values_.index() != kJsonArrayValues) {
+    ss << kStringSquareBracketClose;
+    return ss.str();
+  }
+  const JsonValues &values = std::get<kJsonArrayValues>(values_);
+  for (auto it = values.begin(); it != values.end(); it++) {
     ss << sep;
     if (it->type() == typeid(void)) {
       ss << kJsonNull;
@@ -467,13 +1713,14 @@ std::string JsonArray::String() const {
       ss << std::any_cast<JsonInteger>(*it);
     } else if (it->type() == typeid(JsonFloat)) {
       ss << std::fixed << std::any_cast<JsonFloat>(*it);
-    } else if (it->type() == typeid(JsonString)) {
-      ss << kStringDoubleQuote << std::any_cast<JsonString>(*it)
-         << kStringDoubleQuote;
+    } else if (json::IsString(*it)) {
+      ss << kStringDoubleQuote << json::GetString(*it) << kStringDoubleQuote;
     } else if (it->type() == typeid(JsonObject)) {
-      ss << std::any_cast<JsonObject>(*it).String();
+      ss << std::any_cast<const JsonObject &>(*it).String();
     } else if (it->type() == typeid(JsonArray)) {
-      ss << std::any_cast<JsonArray>(*it).String();
+      ss << std::any_cast<const JsonArray &>(*it).String();
+    } else if (it->type() == typeid(JsonLazy)) {
+      ss << std::any_cast<const JsonLazy &>(*it).GetSource();
     } else {
       throw std::runtime_error("incompatible json type");
     }
@@ -483,13 +1730,90 @@ std::string JsonArray::String() const {
   return ss.str();
 }
 
+std::string JsonArray::CanonicalString() const {
+  std::string result;
+  json::WriteCanonical(*this, result);
+  return result;
+}
+
+std::pmr::memory_resource *JsonArray::Resource() const {
+  return std::visit(
+      [](const auto &values) { return values.get_allocator().resource(); },
+      values_);
+}
+
+bool JsonArray::Pack(size_t storage) {
+  if (values_.index() == storage) {
+    return true;
+  }
+  if (Size() > 0) {
+    return false;
+  }
+  std::pmr::memory_resource *resource = Resource();
+  switch (storage) {
+    case kJsonArrayIntegers:
+      values_.emplace<kJsonArrayIntegers>(resource);
+      break;
+    case kJsonArrayFloats:
+      values_.emplace<kJsonArrayFloats>(resource);
+      break;
+    case kJsonArrayStrings:
+      values_.emplace<kJsonArrayStrings>(resource);
+      break;
+    default:
+      values_.emplace<kJsonArrayValues>(resource);
+  }
+  return true;
+}
+
+JsonValues &JsonArray::Generalize() {
+  if (values_.index() == kJsonArrayValues) {
+    return std::get<kJsonArrayValues>(values_);
+  }
+  JsonValues values(Resource());
+  values.reserve(Size() + 1);
+  if (values_.index() == kJsonArrayIntegers) {
+    for (JsonInteger value : std::get<kJsonArrayIntegers>(values_)) {
+      values.emplace_back(value);
+    }
+  } else if (values_.index() == kJsonArrayFloats) {
+    for (JsonFloat value : std::get<kJsonArrayFloats>(values_)) {
+      values.emplace_back(value);
+    }
+  } else {
+    for (const std::pmr::string &value : std::get<kJsonArrayStrings>(values_)) {
+      values.emplace_back(JsonString(value));
+    }
+  }
+  values_ = std::move(values);
+  return std::get<kJsonArrayValues>(values_);
+}
+
+void JsonArray::Put(JsonValue &&value) {
+  if (value.type() == typeid(JsonInteger)) {
+    PutInteger(std::any_cast<JsonInteger>(value));
+  } else if (value.type() == typeid(JsonFloat)) {
+    PutFloat(std::any_cast<JsonFloat>(value));
+  } else if (value.type() == typeid(JsonString)) {
+    PutString(std::any_cast<const JsonString &>(value));
+  } else {
+    Generalize().emplace_back(std::move(value));
+  }
+}
+
 void JsonArray::Parse(const std::string &source) {
   size_t offset = 0;
-  Parse(source, offset);
+  Parse(source, offset, false);
+}
+
+void JsonArray::ParseLazy(const std::string &source) {
+  size_t offset = 0;
+  Parse(source, offset, true);
 }
 
-void JsonArray::Parse(const std::string &source, size_t &source_offset) {
-  values_.clear();
+void JsonArray::Parse(const std::string &source, size_t &source_offset,
+                      bool lazy) {
+  Clear();
   const std::string kValueBorder =
       kStringWss + kStringComma + kStringSquareBracketClose;
   size_t offset = source_offset;
@@ -498,11 +1822,14 @@ void JsonArray::Parse(const std::string &source, size_t &source_offset) {
   JsonObject object;
   JsonArray array;
   char border;
-  bool dot;
-  std::string text;
+  JsonNumber number;
   if (!StringExpect(source, kStringSquareBracketOpen, offset)) {
     throw std::runtime_error("json: initial bracket");
   }
+  if (StringExpect(source, kStringSquareBracketClose, offset)) {
+    source_offset = offset;
+    return;
+  }
   for (;;) {
     if (!StringExpect(source, kStringEmpty, offset)) {
       throw std::runtime_error("json: value start");
@@ -572,38 +1899,39 @@ void JsonArray::Parse(const std::string &source, size_t &source_offset) {
       case kCharPlus:
         [[fallthrough]];
       case kCharMinus:
-        position = offset + 1;
-        dot = false;
-        while (position < source.length()) {
-          if (CharIsAnyOf(source[position], kValueBorder)) {
-            break;
-          }
-          if (source[position] == kCharDot) {
-            dot = true;
-          }
-          position++;
-        }
-        if (position == source.length()) {
+        if (!json::ParseNumber(source, offset, number) ||
+            offset == source.length() ||
+            !CharIsAnyOf(source[offset], kValueBorder)) {
           throw std::runtime_error("json: parse number value");
         }
-        text = source.substr(offset, position - offset);
-        try {
-          if (dot) {
-            PutFloat(std::atof(text.c_str()));
-          } else {
-            PutInteger(std::atoi(text.c_str()));
-          }
-        } catch (std::invalid_argument &) {
-          throw std::runtime_error("json: parse number value");
+        if (std::holds_alternative<JsonInteger>(number)) {
+          PutInteger(std::get<JsonInteger>(number));
+        } else {
+          PutFloat(std::get<JsonFloat>(number));
         }
-        offset = position;
         break;
       case kCharCurlyBracketOpen:
-        object.Parse(source, offset);
+        if (lazy) {
+          position = offset;
+          if (!json::Skip(source, offset)) {
+            throw std::runtime_error("json: parse object value");
+          }
+          Generalize().emplace_back(JsonLazy(source, position, offset));
+          break;
+        }
+        object.Parse(source, offset, false);
         PutObject(object);
         break;
       case kCharSquareBracketOpen:
-        array.Parse(source, offset);
+        if (lazy) {
+          position = offset;
+          if (!json::Skip(source, offset)) {
+            throw std::runtime_error("json: parse array value");
+          }
+          Generalize().emplace_back(JsonLazy(source, position, offset));
+          break;
+        }
+        array.Parse(source, offset, false);
         PutArray(array);
         break;
       default:
@@ -625,9 +1953,124 @@ void JsonArray::Parse(const std::string &source, size_t &source_offset) {
   source_offset = offset;
 }
 
+class JsonDecoder {
+ public:
+  template <class S>
+  static size_t Value(JsonValue &value, S &source);
+  template <class S>
+  static size_t Object(JsonObject &object, S &source);
+  template <class S>
+  static size_t Array(JsonArray &object, S &source);
+};
+
+template <class S>
+size_t JsonDecoder::Value(JsonValue &value, S &source) {
+  uint8_t type_id;
+  if (encoding::ReadBytes(source, &type_id, sizeof(uint8_t)) ==
+      std::string::npos) {
+    return std::string::npos;
+  }
+  size_t bytes = sizeof(uint8_t);
+  size_t value_bytes;
+  if (type_id == kJsonTypeNull) {
+    value.reset();
+    return bytes;
+  } else if (type_id == kJsonTypeBoolean) {
+    uint8_t boolean;
+    value_bytes = encoding::ReadBytes(source, &boolean, sizeof(uint8_t));
+    value = (JsonBoolean)(boolean != 0);
+  } else if (type_id == kJsonTypeInteger) {
+    if (encoding::IsLegacy(source)) {
+      JsonInteger number;
+      value_bytes = encoding::ReadBytes(source, &number, sizeof(JsonInteger));
+      value = number;
+    } else {
+      uint64_t number;
+      value_bytes = encoding::ReadVarint(source, number);
+      value = (JsonInteger)encoding::ZigZagDecode(number);
+    }
+  } else if (type_id == kJsonTypeFloat) {
+    JsonFloat number;
+    value_bytes = encoding::ReadBytes(source, &number, sizeof(JsonFloat));
+    value = number;
+  } else if (type_id == kJsonTypeString) {
+    value_bytes = encoding::ReadString(source, value.emplace<JsonString>());
+  } else if (type_id == kJsonTypeObject) {
+    value_bytes = Object(value.emplace<JsonObject>(), source);
+  } else if (type_id == kJsonTypeArray) {
+    value_bytes = Array(value.emplace<JsonArray>(), source);
+  } else if (type_id == kJsonTypeSymbol && !encoding::IsLegacy(source)) {
+    value_bytes = encoding::ReadKey(source, value.emplace<JsonString>());
+  } else if (type_id == kJsonTypeLazy && !encoding::IsLegacy(source)) {
+    std::string text;
+    value_bytes = encoding::ReadString(source, text);
+    size_t offset = 0;
+    if (value_bytes != std::string::npos &&
+        (!json::Skip(text, offset) || offset != text.length())) {
+      throw std::runtime_error("json: invalid lazy value");
+    }
+    value = JsonLazy(text);
+  } else {
+    throw std::runtime_error("incompatible json type");
+  }
+  if (value_bytes == std::string::npos) {
+    return value_bytes;
+  }
+  return bytes + value_bytes;
+}
+
+template <class S>
+size_t JsonDecoder::Object(JsonObject &object, S &source) {
+  object.Clear();
+  size_t size;
+  size_t bytes = encoding::ReadLength(source, size);
+  if (bytes == std::string::npos) {
+    return bytes;
+  }
+  std::string key;
+  JsonValue value;
+  size_t value_bytes;
+  for (size_t i = 0; i < size; i++) {
+    value_bytes = encoding::ReadKey(source, key);
+    if (value_bytes == std::string::npos) {
+      return value_bytes;
+    }
+    bytes += value_bytes;
+    value_bytes = Value(value, source);
+    if (value_bytes == std::string::npos) {
+      return value_bytes;
+    }
+    bytes += value_bytes;
+    object.Put(key, std::move(value));
+  }
+  return bytes;
+}
+
+template <class S>
+size_t JsonDecoder::Array(JsonArray &object, S &source) {
+  object.Clear();
+  size_t size;
+  size_t bytes = encoding::ReadLength(source, size);
+  if (bytes == std::string::npos) {
+    return bytes;
+  }
+  size_t value_bytes;
+  for (size_t i = 0; i < size; i++) {
+    JsonValue value;
+    value_bytes = Value(value, source);
+    if (value_bytes == std::string::npos) {
+      return value_bytes;
+    }
+    bytes += value_bytes;
+    object.Put(std::move(value));
+  }
+  return bytes;
+}
+
 namespace json {
 
-size_t Serialize(const JsonObject &object, std::ostream &stream) {
+static size_t SerializeLegacy(const JsonObject &object,
+                              std::ostream &stream) {
   size_t bytes = 0;
   std::vector<std::string> keys = object.Keys();
   size_t size = keys.size();
@@ -644,11 +2087,8 @@ size_t Serialize(const JsonObject &object, std::ostream &stream) {
       bytes += sizeof(uint8_t);
     } else if (object.IsBoolean(keys[i])) {
       stream.write((const char *)&kJsonTypeBoolean, sizeof(uint8_t));
-      if (object.GetBoolean(keys[i])) {
-        stream.write((const char *)&kJsonTrue, sizeof(JsonBoolean));
-      } else {
-        stream.write((const char *)&kJsonFalse, sizeof(JsonBoolean));
-      }
+      JsonBoolean value = object.GetBoolean(keys[i]);
+      stream.write((const char *)&value, sizeof(JsonBoolean));
       bytes += sizeof(uint8_t) + sizeof(JsonBoolean);
     } else if (object.IsInteger(keys[i])) {
       stream.write((const char *)&kJsonTypeInteger, sizeof(uint8_t));
@@ -682,62 +2122,8 @@ size_t Serialize(const JsonObject &object, std::ostream &stream) {
   return stream ? bytes : std::string::npos;
 }
 
-size_t Deserialize(JsonObject &object, std::istream &stream) {
-  object.Clear();
-  size_t bytes = 0;
-  size_t size;
-  stream.read((char *)&size, sizeof(size_t));
-  size_t length;
-  bytes += sizeof(size_t);
-  std::string key;
-  for (size_t i = 0; i < size; i++) {
-    stream.read((char *)&length, sizeof(size_t));
-    key.resize(length);
-    stream.read((char *)&key[0], length);
-    bytes += sizeof(size_t) + length;
-    uint8_t type_id;
-    stream.read((char *)&type_id, sizeof(uint8_t));
-    bytes += sizeof(uint8_t);
-    if (type_id == kJsonTypeNull) {
-      object.PutNull(key);
-    } else if (type_id == kJsonTypeBoolean) {
-      JsonBoolean value;
-      stream.read((char *)&value, sizeof(JsonBoolean));
-      object.PutBoolean(key, value);
-      bytes += sizeof(JsonBoolean);
-    } else if (type_id == kJsonTypeInteger) {
-      JsonInteger value;
-      stream.read((char *)&value, sizeof(JsonInteger));
-      object.PutInteger(key, value);
-      bytes += sizeof(JsonInteger);
-    } else if (type_id == kJsonTypeFloat) {
-      JsonFloat value;
-      stream.read((char *)&value, sizeof(JsonFloat));
-      object.PutFloat(key, value);
-      bytes += sizeof(JsonFloat);
-    } else if (type_id == kJsonTypeString) {
-      JsonString value;
-      stream.read((char *)&length, sizeof(size_t));
-      value.resize(length);
-      stream.read((char *)&value[0], length);
-      object.PutString(key, value);
-      bytes += sizeof(size_t) + length;
-    } else if (type_id == kJsonTypeObject) {
-      JsonObject value;
-      bytes += json::Deserialize(value, stream);
-      object.PutObject(key, value);
-    } else if (type_id == kJsonTypeArray) {
-      JsonArray value;
-      bytes += json::Deserialize(value, stream);
-      object.PutArray(key, value);
-    } else {
-      throw std::runtime_error("incompatible json type");
-    }
-  }
-  return stream ? bytes : std::string::npos;
-}
-
-size_t Serialize(const JsonArray &object, std::ostream &stream) {
+static size_t SerializeLegacy(const JsonArray &object,
+                              std::ostream &stream) {
   size_t bytes = 0;
   size_t size = object.Size();
   stream.write((const char *)&size, sizeof(size_t));
@@ -748,11 +2134,8 @@ size_t Serialize(const JsonArray &object, std::ostream &stream) {
       bytes += sizeof(uint8_t);
     } else if (object.IsBoolean(i)) {
       stream.write((const char *)&kJsonTypeBoolean, sizeof(uint8_t));
-      if (object.GetBoolean(i)) {
-        stream.write((const char *)&kJsonTrue, sizeof(JsonBoolean));
-      } else {
-        stream.write((const char *)&kJsonFalse, sizeof(JsonBoolean));
-      }
+      JsonBoolean value = object.GetBoolean(i);
+      stream.write((const char *)&value, sizeof(JsonBoolean));
       bytes += sizeof(uint8_t) + sizeof(JsonBoolean);
     } else if (object.IsInteger(i)) {
       stream.write((const char *)&kJsonTypeInteger, sizeof(uint8_t));
@@ -776,7 +2159,7 @@ size_t Serialize(const JsonArray &object, std::ostream &stream) {
       JsonObject value = object.GetObject(i);
       bytes += sizeof(uint8_t) + json::Serialize(value, stream);
     } else if (object.IsArray(i)) {
-      stream.write((const char *)kJsonTypeArray, sizeof(uint8_t));
+      stream.write((const char *)&kJsonTypeArray, sizeof(uint8_t));
       JsonArray value = object.GetArray(i);
       bytes += sizeof(uint8_t) + json::Serialize(value, stream);
     } else {
@@ -786,56 +2169,160 @@ size_t Serialize(const JsonArray &object, std::ostream &stream) {
   return stream ? bytes : std::string::npos;
 }
 
-size_t Deserialize(JsonArray &object, std::istream &stream) {
-  object.Clear();
-  size_t bytes = 0;
-  size_t size;
-  stream.read((char *)&size, sizeof(size_t));
-  bytes += sizeof(size_t);
-  for (size_t i = 0; i < size; i++) {
-    uint8_t type_id;
-    stream.read((char *)&type_id, sizeof(uint8_t));
-    bytes += sizeof(uint8_t);
-    if (type_id == kJsonTypeNull) {
-      object.PutNull();
-    } else if (type_id == kJsonTypeBoolean) {
-      JsonBoolean value;
-      stream.read((char *)&value, sizeof(JsonBoolean));
-      object.PutBoolean(value);
-      bytes += sizeof(JsonBoolean);
-    } else if (type_id == kJsonTypeInteger) {
-      JsonInteger value;
-      stream.read((char *)&value, sizeof(JsonInteger));
-      object.PutInteger(value);
-      bytes += sizeof(JsonInteger);
-    } else if (type_id == kJsonTypeFloat) {
-      JsonFloat value;
-      stream.read((char *)&value, sizeof(JsonFloat));
-      object.PutFloat(value);
-      bytes += sizeof(JsonFloat);
-    } else if (type_id == kJsonTypeString) {
-      JsonString value;
-      size_t length;
-      stream.read((char *)&length, sizeof(size_t));
-      value.resize(length);
-      stream.read((char *)&value[0], length);
-      object.PutString(value);
-      bytes += sizeof(size_t) + length;
-    } else if (type_id == kJsonTypeObject) {
-      JsonObject value;
-      bytes += json::Deserialize(value, stream);
-      object.PutObject(value);
-    } else if (type_id == kJsonTypeArray) {
-      JsonArray value;
-      bytes += json::Deserialize(value, stream);
-      object.PutArray(value);
+static size_t SerializeValue(const JsonValue &value, std::ostream &stream) {
+  size_t bytes = sizeof(uint8_t);
+  if (!value.has_value()) {
+    stream.write((const char *)&kJsonTypeNull, sizeof(uint8_t));
+  } else if (value.type() == typeid(JsonBoolean)) {
+    stream.write((const char *)&kJsonTypeBoolean, sizeof(uint8_t));
+    JsonBoolean boolean = std::any_cast<JsonBoolean>(value);
+    stream.write((const char *)&boolean, sizeof(JsonBoolean));
+    bytes += sizeof(JsonBoolean);
+  } else if (value.type() == typeid(JsonInteger)) {
+    stream.write((const char *)&kJsonTypeInteger, sizeof(uint8_t));
+    bytes += encoding::WriteVarint(
+        stream, encoding::ZigZagEncode(std::any_cast<JsonInteger>(value)));
+  } else if (value.type() == typeid(JsonFloat)) {
+    stream.write((const char *)&kJsonTypeFloat, sizeof(uint8_t));
+    JsonFloat number = std::any_cast<JsonFloat>(value);
+    stream.write((const char *)&number, sizeof(JsonFloat));
+    bytes += sizeof(JsonFloat);
+  } else if (value.type() == typeid(JsonString)) {
+    stream.write((const char *)&kJsonTypeString, sizeof(uint8_t));
+    bytes += encoding::WriteString(stream,
+                                   std::any_cast<const JsonString &>(value));
+  } else if (value.type() == typeid(JsonObject)) {
+    stream.write((const char *)&kJsonTypeObject, sizeof(uint8_t));
+    bytes += json::Serialize(std::any_cast<const JsonObject &>(value), stream);
+  } else if (value.type() == typeid(JsonArray)) {
+    stream.write((const char *)&kJsonTypeArray, sizeof(uint8_t));
+    bytes += json::Serialize(std::any_cast<const JsonArray &>(value), stream);
+  } else if (value.type() == typeid(JsonSymbol)) {
+    stream.write((const char *)&kJsonTypeSymbol, sizeof(uint8_t));
+    bytes += encoding::WriteKey(
+        stream, std::any_cast<const JsonSymbol &>(value).GetString());
+  } else if (value.type() == typeid(JsonLazy)) {
+    stream.write((const char *)&kJsonTypeLazy, sizeof(uint8_t));
+    bytes += encoding::WriteString(
+        stream, std::any_cast<const JsonLazy &>(value).GetSource());
+  } else {
+    throw std::runtime_error("incompatible json type");
+  }
+  return bytes;
+}
+
+size_t Serialize(const JsonObject &object, std::ostream &stream) {
+  if (encoding::IsLegacy(stream)) {
+    return SerializeLegacy(object, stream);
+  }
+  size_t bytes = encoding::WriteVarint(stream, object.Size());
+  if (object.dictionary_) {
+    for (size_t i = 0; i < object.dictionary_->Size(); i++) {
+      bytes += encoding::WriteKey(stream, object.dictionary_->Key(i));
+      bytes += SerializeValue(object.dictionary_->Value(i), stream);
+    }
+  } else {
+    for (size_t i = 0; i < object.slots_.size(); i++) {
+      bytes += encoding::WriteKey(stream, object.shape_->Key(i));
+      bytes += SerializeValue(object.slots_[i], stream);
+    }
+  }
+  return stream ? bytes : std::string::npos;
+}
+
+size_t Deserialize(JsonObject &object, std::istream &stream) {
+  return JsonDecoder::Object(object, stream);
+}
+
+size_t Deserialize(JsonObject &object, EncodingReader &reader) {
+  return JsonDecoder::Object(object, reader);
+}
+
+void WriteCanonical(const JsonObject &object, std::string &target) {
+  std::vector<std::pair<const std::string *, const JsonValue *>> members;
+  members.reserve(object.Size());
+  if (object.dictionary_) {
+    for (size_t i = 0; i < object.dictionary_->Size(); i++) {
+      members.emplace_back(&object.dictionary_->Key(i),
+                           &object.dictionary_->Value(i));
+    }
+  } else {
+    for (size_t i = 0; i < object.slots_.size(); i++) {
+      members.emplace_back(&object.shape_->Key(i), &object.slots_[i]);
+    }
+  }
+  std::sort(members.begin(), members.end(),
+            [](const auto &a, const auto &b) { return *a.first < *b.first; });
+  target += kCharCurlyBracketOpen;
+  for (size_t i = 0; i < members.size(); i++) {
+    if (i > 0) {
+      target += kCharComma;
+    }
+    target += kCharDoubleQuote;
+    target += *members[i].first;
+    target += kCharDoubleQuote;
+    target += kCharColon;
+    WriteCanonical(*members[i].second, target);
+  }
+  target += kCharCurlyBracketClose;
+}
+
+void WriteCanonical(const JsonArray &array, std::string &target) {
+  target += kCharSquareBracketOpen;
+  for (size_t i = 0; i < array.Size(); i++) {
+    if (i > 0) {
+      target += kCharComma;
+    }
+    if (array.values_.index() == kJsonArrayValues) {
+      WriteCanonical(std::get<kJsonArrayValues>(array.values_)[i], target);
     } else {
-      throw std::runtime_error("incompatible json type");
+      WriteCanonical(array.GetValue(i), target);
+    }
+  }
+  target += kCharSquareBracketClose;
+}
+
+size_t Serialize(const JsonArray &object, std::ostream &stream) {
+  if (encoding::IsLegacy(stream)) {
+    return SerializeLegacy(object, stream);
+  }
+  size_t bytes = encoding::WriteVarint(stream, object.Size());
+  if (object.values_.index() == kJsonArrayIntegers) {
+    for (JsonInteger value : std::get<kJsonArrayIntegers>(object.values_)) {
+      stream.write((const char *)&kJsonTypeInteger, sizeof(uint8_t));
+      bytes += sizeof(uint8_t) +
+               encoding::WriteVarint(stream, encoding::ZigZagEncode(value));
+    }
+  } else if (object.values_.index() == kJsonArrayFloats) {
+    for (JsonFloat value : std::get<kJsonArrayFloats>(object.values_)) {
+      stream.write((const char *)&kJsonTypeFloat, sizeof(uint8_t));
+      stream.write((const char *)&value, sizeof(JsonFloat));
+      bytes += sizeof(uint8_t) + sizeof(JsonFloat);
+    }
+  } else if (object.values_.index() == kJsonArrayStrings) {
+    for (const std::pmr::string &value :
+         std::get<kJsonArrayStrings>(object.values_)) {
+      stream.write((const char *)&kJsonTypeString, sizeof(uint8_t));
+      bytes += sizeof(uint8_t) + encoding::WriteLength(stream, value.length());
+      stream.write(value.data(), value.length());
+      bytes += value.length();
+    }
+  } else {
+    for (const JsonValue &value : std::get<kJsonArrayValues>(object.values_)) {
+      bytes += SerializeValue(value, stream);
     }
   }
   return stream ? bytes : std::string::npos;
 }
 
+size_t Deserialize(JsonArray &object, std::istream &stream) {
+  return JsonDecoder::Array(object, stream);
+}
+
+size_t Deserialize(JsonArray &object, EncodingReader &reader) {
+  return JsonDecoder::Array(object, reader);
+}
+
 JsonObject RandomObject(Random &random) {
   JsonObject object;
   object.PutBoolean(kJsonKeySet[0],
@@ -871,10 +2358,32 @@ JsonArray RandomObjectArray(Random &random) {
 }
 
 uint64_t Memory(const JsonObject &object) {
-  uint64_t result = sizeof(std::unordered_map<std::string, std::any>);
+  uint64_t result = sizeof(std::shared_ptr<const JsonShape>) +
+                    sizeof(std::vector<std::any>) +
+                    sizeof(std::unique_ptr<JsonDictionary>) + sizeof(uint64_t);
+  if (object.dictionary_) {
+    result += sizeof(JsonDictionary) +
+              (object.dictionary_->Capacity() - object.dictionary_->Size()) *
+                  sizeof(std::pair<std::string, std::any>);
+  } else {
+    result += (object.slots_.capacity() - object.slots_.size()) *
+              sizeof(std::any);
+  }
   for (std::string key : object.Keys()) {
-    result += sizeof(std::string) + key.length();
-    if (object.IsArray(key)) {
+    if (object.dictionary_) {
+      result += sizeof(std::string) + key.length();
+      if (!object.dictionary_->IsFlat()) {
+        result += sizeof(std::string) + key.length() + sizeof(size_t) +
+                  2 * sizeof(void *);
+      }
+    }
+    const JsonValue &value = object.At(key);
+    if (value.type() == typeid(JsonLazy)) {
+      result += sizeof(std::any) + sizeof(JsonLazy) +
+                std::any_cast<const JsonLazy &>(value).GetSource().capacity();
+    } else if (value.type() == typeid(JsonSymbol)) {
+      result += sizeof(std::any);
+    } else if (object.IsArray(key)) {
       result += json::Memory(object.GetArray(key));
     } else if (object.IsBoolean(key)) {
       result += sizeof(std::any);
@@ -897,9 +2406,32 @@ uint64_t Memory(const JsonObject &object) {
 }
 
 uint64_t Memory(const JsonArray &object) {
-  uint64_t result = sizeof(std::vector<std::any>);
+  uint64_t result = sizeof(object.values_);
+  if (object.values_.index() == kJsonArrayIntegers) {
+    return result + std::get<kJsonArrayIntegers>(object.values_).capacity() *
+                        sizeof(JsonInteger);
+  } else if (object.values_.index() == kJsonArrayFloats) {
+    return result + std::get<kJsonArrayFloats>(object.values_).capacity() *
+                        sizeof(JsonFloat);
+  } else if (object.values_.index() == kJsonArrayStrings) {
+    const JsonStrings &values = std::get<kJsonArrayStrings>(object.values_);
+    result += values.capacity() * sizeof(std::pmr::string);
+    for (const std::pmr::string &value : values) {
+      if (value.capacity() >= sizeof(std::pmr::string)) {
+        result += value.capacity() + 1;
+      }
+    }
+    return result;
+  }
+  const JsonValues &values = std::get<kJsonArrayValues>(object.values_);
   for (size_t i = 0; i < object.Size(); i++) {
-    if (object.IsArray(i)) {
+    if (values[i].type() == typeid(JsonLazy)) {
+      const JsonLazy &lazy = std::any_cast<const JsonLazy &>(values[i]);
+      result += sizeof(std::any) + sizeof(JsonLazy) +
+                lazy.GetSource().capacity();
+    } else if (values[i].type() == typeid(JsonSymbol)) {
+      result += sizeof(std::any);
+    } else if (object.IsArray(i)) {
       result += json::Memory(object.GetArray(i));
     } else if (object.IsBoolean(i)) {
       result += sizeof(std::any);
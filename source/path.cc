@@ -0,0 +1,380 @@
+/* Copyright 2022 Jonas Hegemann <jonas.hegemann@hotmail.de>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "path.h"
+
+JsonPathStep::JsonPathStep(const std::string &key, size_t index, bool keyed)
+    : key_(key), index_(index), keyed_(keyed) {}
+
+JsonPathStep::~JsonPathStep() {}
+
+const std::string &JsonPathStep::GetKey() const { return key_; }
+
+size_t JsonPathStep::GetIndex() const { return index_; }
+
+bool JsonPathStep::IsKeyed() const { return keyed_; }
+
+bool JsonPathStep::IsIndexed() const { return index_ != std::string::npos; }
+
+static bool Seek(const std::string &source, size_t &offset,
+                 const JsonPathStep &step) {
+  size_t position;
+  bool found;
+  if (!StringExpect(source, kStringEmpty, offset)) {
+    return false;
+  }
+  if (source[offset] == kCharCurlyBracketOpen && step.IsKeyed()) {
+    offset++;
+    if (StringExpect(source, kStringCurlyBracketClose, offset)) {
+      return false;
+    }
+    for (;;) {
+      if (!StringExpect(source, kStringDoubleQuote, offset)) {
+        return false;
+      }
+      position = source.find(kCharDoubleQuote, offset);
+      if (position == std::string::npos) {
+        return false;
+      }
+      found = source.compare(offset, position - offset, step.GetKey()) == 0;
+      offset = position + 1;
+      if (!StringExpect(source, kStringColon, offset)) {
+        return false;
+      }
+      if (found) {
+        return true;
+      }
+      if (!json::Skip(source, offset) ||
+          !StringExpect(source, kStringComma, offset)) {
+        return false;
+      }
+    }
+  }
+  if (source[offset] == kCharSquareBracketOpen && step.IsIndexed()) {
+    offset++;
+    if (StringExpect(source, kStringSquareBracketClose, offset)) {
+      return false;
+    }
+    for (size_t i = 0; i < step.GetIndex(); i++) {
+      if (!json::Skip(source, offset) ||
+          !StringExpect(source, kStringComma, offset)) {
+        return false;
+      }
+    }
+    return true;
+  }
+  return false;
+}
+
+JsonReference::JsonReference()
+    : object_(nullptr),
+      value_(nullptr),
+      array_(nullptr),
+      index_(std::string::npos) {}
+
+JsonReference::~JsonReference() {}
+
+bool JsonReference::IsMissing() const {
+  return object_ == nullptr && value_ == nullptr && array_ == nullptr;
+}
+
+bool JsonReference::IsNull() const {
+  return value_ != nullptr && !value_->has_value();
+}
+
+bool JsonReference::IsBoolean() const {
+  return value_ != nullptr && json::IsBoolean(*value_);
+}
+
+bool JsonReference::IsInteger() const {
+  if (array_ != nullptr) {
+    return array_->IsInteger(index_);
+  }
+  return value_ != nullptr && json::IsInteger(*value_);
+}
+
+bool JsonReference::IsFloat() const {
+  if (array_ != nullptr) {
+    return array_->IsFloat(index_);
+  }
+  return value_ != nullptr && json::IsFloat(*value_);
+}
+
+bool JsonReference::IsString() const {
+  if (array_ != nullptr) {
+    return array_->IsString(index_);
+  }
+  return value_ != nullptr && json::IsString(*value_);
+}
+
+bool JsonReference::IsObject() const { return GetObject() != nullptr; }
+
+bool JsonReference::IsArray() const { return GetArray() != nullptr; }
+
+JsonBoolean JsonReference::GetBoolean() const {
+  if (value_ == nullptr) {
+    throw std::bad_any_cast();
+  }
+  return std::any_cast<JsonBoolean>(*value_);
+}
+
+JsonInteger JsonReference::GetInteger() const {
+  if (array_ != nullptr) {
+    return array_->GetInteger(index_);
+  } else if (value_ == nullptr) {
+    throw std::bad_any_cast();
+  }
+  return std::any_cast<JsonInteger>(*value_);
+}
+
+JsonFloat JsonReference::GetFloat() const {
+  if (array_ != nullptr) {
+    return array_->GetFloat(index_);
+  } else if (value_ != nullptr && json::IsFloat(*value_)) {
+    return std::any_cast<JsonFloat>(*value_);
+  } else if (value_ != nullptr && json::IsInteger(*value_)) {
+    return (JsonFloat)std::any_cast<JsonInteger>(*value_);
+  }
+  throw std::runtime_error("invalid type");
+}
+
+std::string_view JsonReference::GetString() const {
+  if (array_ != nullptr) {
+    const JsonStrings *strings = std::get_if<JsonStrings>(&array_->values_);
+    if (strings == nullptr) {
+      throw std::bad_any_cast();
+    }
+    return (*strings)[index_];
+  } else if (value_ == nullptr) {
+    throw std::bad_any_cast();
+  }
+  return json::GetString(*value_);
+}
+
+const JsonObject *JsonReference::GetObject() const {
+  if (object_ != nullptr) {
+    return object_;
+  }
+  return value_ != nullptr ? std::any_cast<JsonObject>(value_) : nullptr;
+}
+
+const JsonArray *JsonReference::GetArray() const {
+  return value_ != nullptr ? std::any_cast<JsonArray>(value_) : nullptr;
+}
+
+void JsonReference::Resolve() {
+  const JsonLazy *lazy =
+      value_ != nullptr ? std::any_cast<JsonLazy>(value_) : nullptr;
+  if (lazy == nullptr) {
+    return;
+  }
+  if (lazy->IsObject()) {
+    owner_ = std::make_shared<const JsonValue>(lazy->GetObject());
+  } else {
+    owner_ = std::make_shared<const JsonValue>(lazy->GetArray());
+  }
+  value_ = owner_.get();
+}
+
+JsonPath::JsonPath() {}
+
+JsonPath::JsonPath(const std::string &path) { Parse(path); }
+
+JsonPath::~JsonPath() {}
+
+size_t JsonPath::Size() const { return steps_.size(); }
+
+bool JsonPath::IsEmpty() const { return steps_.empty(); }
+
+JsonReference JsonPath::Find(const JsonObject &object) const {
+  JsonReference reference;
+  reference.object_ = &object;
+  const JsonObject *current_object = &object;
+  const JsonArray *current_array = nullptr;
+  for (size_t i = 0; i < steps_.size(); i++) {
+    const JsonPathStep &step = steps_[i];
+    reference.object_ = nullptr;
+    reference.value_ = nullptr;
+    reference.array_ = nullptr;
+    if (current_object != nullptr && step.IsKeyed()) {
+      reference.value_ = current_object->Lookup(step.GetKey());
+    } else if (current_array != nullptr && step.IsIndexed() &&
+               step.GetIndex() < current_array->Size()) {
+      const JsonValues *values =
+          std::get_if<JsonValues>(&current_array->values_);
+      if (values != nullptr) {
+        reference.value_ = &(*values)[step.GetIndex()];
+      } else {
+        reference.array_ = current_array;
+        reference.index_ = step.GetIndex();
+      }
+    }
+    if (reference.IsMissing()) {
+      return JsonReference();
+    }
+    if (i + 1 == steps_.size()) {
+      reference.Resolve();
+      break;
+    }
+    current_object = nullptr;
+    current_array = nullptr;
+    if (reference.value_ == nullptr) {
+      return JsonReference();
+    }
+    current_object = std::any_cast<JsonObject>(reference.value_);
+    if (current_object == nullptr) {
+      current_array = std::any_cast<JsonArray>(reference.value_);
+    }
+    if (current_object == nullptr && current_array == nullptr &&
+        i + 2 < steps_.size()) {
+      const JsonLazy *lazy = std::any_cast<JsonLazy>(reference.value_);
+      if (lazy == nullptr) {
+        return JsonReference();
+      }
+      const std::string &source = lazy->GetSource();
+      size_t begin = 0;
+      for (; i + 2 < steps_.size(); i++) {
+        if (!Seek(source, begin, steps_[i + 1])) {
+          return JsonReference();
+        }
+      }
+      if (!StringExpect(source, kStringEmpty, begin) ||
+          (source[begin] != kCharCurlyBracketOpen &&
+           source[begin] != kCharSquareBracketOpen)) {
+        return JsonReference();
+      }
+      size_t end = begin;
+      if (!json::Skip(source, end)) {
+        return JsonReference();
+      }
+      reference.owner_ =
+          std::make_shared<const JsonValue>(JsonLazy(source, begin, end));
+      reference.value_ = reference.owner_.get();
+    }
+    if (current_object == nullptr && current_array == nullptr) {
+      reference.Resolve();
+      current_object = reference.GetObject();
+      current_array = reference.GetArray();
+    }
+  }
+  return reference;
+}
+
+std::string JsonPath::String() const {
+  std::string result;
+  for (const JsonPathStep &step : steps_) {
+    if (step.IsKeyed()) {
+      if (!result.empty()) {
+        result += kCharDot;
+      }
+      result += step.GetKey();
+    } else {
+      result += kCharSquareBracketOpen;
+      result += std::to_string(step.GetIndex());
+      result += kCharSquareBracketClose;
+    }
+  }
+  return result;
+}
+
+void JsonPath::Parse(const std::string &path) {
+  steps_.clear();
+  if (!path.empty() && path[0] == kJsonPathPointer) {
+    ParsePointer(path);
+  } else {
+    ParseDotted(path);
+  }
+}
+
+static size_t ParseIndex(const std::string &source, size_t begin, size_t end) {
+  size_t index;
+  const char *first = source.data() + begin;
+  const char *last = source.data() + end;
+  if (first == last || (*first == kCharZero && last - first > 1)) {
+    return std::string::npos;
+  }
+  std::from_chars_result result = std::from_chars(first, last, index);
+  if (result.ec != std::errc() || result.ptr != last) {
+    return std::string::npos;
+  }
+  return index;
+}
+
+void JsonPath::ParsePointer(const std::string &path) {
+  size_t offset = 1;
+  size_t position;
+  std::string key;
+  for (;;) {
+    position = path.find(kJsonPathPointer, offset);
+    if (position == std::string::npos) {
+      position = path.length();
+    }
+    key.clear();
+    for (size_t i = offset; i < position; i++) {
+      if (path[i] != kJsonPathEscape) {
+        key += path[i];
+      } else if (i + 1 < position && path[i + 1] == kCharOne) {
+        key += kJsonPathPointer;
+        i++;
+      } else if (i + 1 < position && path[i + 1] == kCharZero) {
+        key += kJsonPathEscape;
+        i++;
+      } else {
+        throw std::runtime_error("path: invalid escape");
+      }
+    }
+    steps_.emplace_back(key, ParseIndex(path, offset, position), true);
+    if (position == path.length()) {
+      break;
+    }
+    offset = position + 1;
+  }
+}
+
+void JsonPath::ParseDotted(const std::string &path) {
+  size_t offset = 0;
+  size_t position;
+  size_t index;
+  while (offset < path.length()) {
+    if (path[offset] == kCharSquareBracketOpen) {
+      position = path.find(kCharSquareBracketClose, offset);
+      if (position == std::string::npos) {
+        throw std::runtime_error("path: unterminated index");
+      }
+      index = ParseIndex(path, offset + 1, position);
+      if (index == std::string::npos) {
+        throw std::runtime_error("path: invalid index");
+      }
+      steps_.emplace_back(kStringEmpty, index, false);
+      offset = position + 1;
+    } else {
+      position = path.find_first_of(kJsonPathBorders, offset);
+      if (position == std::string::npos) {
+        position = path.length();
+      }
+      if (position == offset) {
+        throw std::runtime_error("path: empty key");
+      }
+      steps_.emplace_back(path.substr(offset, position - offset),
+                          std::string::npos, true);
+      offset = position;
+    }
+    if (offset == path.length() || path[offset] == kCharSquareBracketOpen) {
+      continue;
+    }
+    if (path[offset] != kCharDot || ++offset == path.length()) {
+      throw std::runtime_error("path: invalid separator");
+    }
+  }
+}
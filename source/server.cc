@@ -38,6 +38,18 @@ static const std::string kUserPath = "userPath";
 static const std::string kUserPathDefault = "./muonbase-user.json";
 static const std::string kLogPath = "logPath";
 static const std::string kLogPathDefault = "./muonbase-server.log";
+static const std::string kCacheSize = "cacheSize";
+static const JsonInteger kCacheSizeDefault = 0;
+static const std::string kStringPool = "stringPool";
+static const bool kStringPoolDefault = false;
+static const std::string kDurability = "durability";
+static const std::string kDurabilityDefault = kDurabilityFlush;
+static const std::string kCheckpoint = "checkpoint";
+static const std::string kCheckpointDefault = kCheckpointMerge;
+static const std::string kLazyLoading = "lazyLoading";
+static const bool kLazyLoadingDefault = false;
+static const std::string kCompression = "compression";
+static const std::string kCompressionDefault = kCompressionNone;
 static const std::string kWorkingDirectory = "workingDirectory";
 static const std::string kWorkingDirectoryDefault = "./";
 
@@ -146,11 +158,75 @@ int main(int argc, char **argv) {
     LOG_INFO("no " + kUserPath + " found, fallback: " + kUserPathDefault);
   }
 
+  JsonInteger cache_size = kCacheSizeDefault;
+  if (config.Has(kCacheSize) && config.IsInteger(kCacheSize) &&
+      config.GetInteger(kCacheSize) >= 0) {
+    cache_size = config.GetInteger(kCacheSize);
+  } else {
+    LOG_INFO("no " + kCacheSize +
+             " found, fallback: " + std::to_string(kCacheSizeDefault));
+  }
+
+  bool string_pool = kStringPoolDefault;
+  if (config.Has(kStringPool) && config.IsBoolean(kStringPool)) {
+    string_pool = config.GetBoolean(kStringPool);
+  } else {
+    LOG_INFO("no " + kStringPool +
+             " found, fallback: " + std::to_string(kStringPoolDefault));
+  }
+
+  DatabaseDurability durability = DURABILITY_FLUSH;
+  std::string durability_name = kStringEmpty;
+  if (config.Has(kDurability) && config.IsString(kDurability)) {
+    durability_name = config.GetString(kDurability);
+  }
+  if (durability_name == kDurabilityNone) {
+    durability = DURABILITY_NONE;
+  } else if (durability_name == kDurabilitySync) {
+    durability = DURABILITY_SYNC;
+  } else if (durability_name != kDurabilityFlush) {
+    LOG_INFO("no " + kDurability + " found, fallback: " + kDurabilityDefault);
+  }
+
+  DatabaseCheckpoint checkpoint = CHECKPOINT_MERGE;
+  std::string checkpoint_name = kStringEmpty;
+  if (config.Has(kCheckpoint) && config.IsString(kCheckpoint)) {
+    checkpoint_name = config.GetString(kCheckpoint);
+  }
+  if (checkpoint_name == kCheckpointFork) {
+    checkpoint = CHECKPOINT_FORK;
+  } else if (checkpoint_name != kCheckpointMerge) {
+    LOG_INFO("no " + kCheckpoint + " found, fallback: " + kCheckpointDefault);
+  }
+
+  bool lazy_loading = kLazyLoadingDefault;
+  if (config.Has(kLazyLoading) && config.IsBoolean(kLazyLoading)) {
+    lazy_loading = config.GetBoolean(kLazyLoading);
+  } else {
+    LOG_INFO("no " + kLazyLoading +
+             " found, fallback: " + std::to_string(kLazyLoadingDefault));
+  }
+
+  CompressionCodec compression = COMPRESSION_NONE;
+  std::string compression_name = kStringEmpty;
+  if (config.Has(kCompression) && config.IsString(kCompression)) {
+    compression_name = config.GetString(kCompression);
+  }
+  if (compression_name == kCompressionLz) {
+    compression = COMPRESSION_LZ;
+  } else if (compression_name != kCompressionNone) {
+    LOG_INFO("no " + kCompression + " found, fallback: " + kCompressionDefault);
+  }
+
   HttpServer server;
 
   LOG_INFO("set up services");
   server.RegisterService(db_api::kServiceDatabase,
-                         new DocumentDatabase(data_path));
+                         new DocumentDatabase(data_path,
+                                              cache_size * 1024 * 1024,
+                                              string_pool, durability,
+                                              checkpoint, lazy_loading,
+                                              compression));
   server.RegisterService(db_api::kServiceUser, new UserPool(user_path));
 
   LOG_INFO("set up routes");
@@ -158,8 +234,11 @@ int main(int argc, char **argv) {
                          db_api::Insert);
   server.RegisterHandler(HttpMethod::POST, db_api::kRouteUpdate,
                          db_api::Update);
+  server.RegisterHandler(HttpMethod::POST, db_api::kRoutePatch, db_api::Patch);
   server.RegisterHandler(HttpMethod::POST, db_api::kRouteErase, db_api::Erase);
   server.RegisterHandler(HttpMethod::POST, db_api::kRouteFind, db_api::Find);
+  server.RegisterStreamHandler(HttpMethod::POST, db_api::kRouteInsert,
+                               db_api::StreamInsert);
 
   LOG_INFO("start server");
   std::string ip = kIpDefault;
@@ -17,46 +17,221 @@ limitations under the License. */
 namespace db {
 
 size_t Serialize(const std::string &filepath, const Database &database,
-                 const std::atomic<bool> &cancel) {
-  size_t bytes;
-  std::ofstream stream;
-  remove(filepath.c_str());
-  stream.open(filepath, std::fstream::binary);
-  bytes = DatabaseSerializer::Serialize(database, stream, cancel);
-  stream.close();
-  return bytes;
+                 CompressionCodec codec, const std::atomic<bool> &cancel) {
+  DatabaseSnapshotWriter writer;
+  if (!writer.Open(filepath, codec)) {
+    return std::string::npos;
+  }
+  for (auto iterator = database.Begin(); iterator != database.End();
+       iterator++) {
+    if (cancel || !writer.Add(iterator.GetKey(), iterator.GetValue())) {
+      return std::string::npos;
+    }
+  }
+  return writer.Close();
 }
 
 size_t Deserialize(const std::string &filepath, Database &database,
                    const std::atomic<bool> &cancel) {
-  size_t bytes;
-  std::ifstream stream;
-  stream.open(filepath, std::fstream::binary);
-  bytes = DatabaseSerializer::Deserialize(database, stream, cancel);
-  stream.close();
+  DatabaseSnapshotReader snapshot;
+  EncodingDictionary dictionary;
+  if (!snapshot.Open(filepath)) {
+    return std::string::npos;
+  }
+  if (!snapshot.IsPaged()) {
+    EncodingReader &reader = snapshot.GetReader();
+    size_t bytes = reader.Offset();
+    if (snapshot.GetFlags() & kEncodingFlagDictionary) {
+      reader.SetDictionary(&dictionary);
+    }
+    size_t database_bytes =
+        DatabaseSerializer::Deserialize(database, reader, cancel);
+    if (database_bytes == std::string::npos) {
+      return database_bytes;
+    }
+    return bytes + database_bytes;
+  }
+  size_t threads = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<std::vector<std::pair<std::string, JsonObject>>> pages;
+  if (!snapshot.Load(pages, threads, cancel)) {
+    return std::string::npos;
+  }
+  database.Load(pages);
+  return FileSize(filepath);
+}
+
+size_t Replay(const std::string &filepath, Database &database,
+              const std::atomic<bool> &cancel) {
+  size_t threads = std::max(1u, std::thread::hardware_concurrency());
+  size_t bytes = DatabaseJournal::Replay(filepath, database, cancel, threads);
+  size_t size = FileSize(filepath);
+  if (!cancel && bytes < size) {
+    LOG_INFO("journal: truncate torn tail of " + std::to_string(size - bytes) +
+             " bytes");
+    if (truncate(filepath.c_str(), bytes) != 0) {
+      throw std::runtime_error("journal: could not truncate torn tail");
+    }
+  }
   return bytes;
 }
 
+size_t Merge(const std::string &filepath, const std::string &target,
+             DatabaseDelta &delta, JsonStringPool *pool,
+             CompressionCodec codec, const std::atomic<bool> &cancel) {
+  DatabaseSnapshotReader snapshot;
+  EncodingDictionary dictionary;
+  std::vector<std::pair<std::string, JsonObject>> entries;
+  size_t size = 0;
+  size_t page = 0;
+  size_t position = 0;
+  if (FileExists(filepath)) {
+    if (!snapshot.Open(filepath)) {
+      throw std::runtime_error("database: could not read snapshot");
+    }
+    if (snapshot.IsPaged()) {
+      size = snapshot.Size();
+    } else {
+      if (snapshot.GetFlags() & kEncodingFlagDictionary) {
+        snapshot.GetReader().SetDictionary(&dictionary);
+      }
+      if (encoding::ReadLength(snapshot.GetReader(), size) ==
+          std::string::npos) {
+        throw std::runtime_error("database: could not read snapshot");
+      }
+    }
+  }
+  auto next = [&](std::string &key, JsonObject &value) {
+    if (!snapshot.IsPaged()) {
+      return Serializer<std::string>::Deserialize(
+                 key, snapshot.GetReader()) != std::string::npos &&
+             Serializer<JsonObject>::Deserialize(
+                 value, snapshot.GetReader()) != std::string::npos;
+    }
+    while (position == entries.size()) {
+      if (page == snapshot.Pages() || !snapshot.Load(page++, entries)) {
+        return false;
+      }
+      position = 0;
+    }
+    key = std::move(entries[position].first);
+    value = std::move(entries[position].second);
+    position++;
+    return true;
+  };
+  DatabaseSnapshotWriter writer;
+  if (!writer.Open(target, codec)) {
+    return std::string::npos;
+  }
+  std::string key;
+  JsonObject value;
+  bool loaded = false;
+  bool good = true;
+  auto emit = [&](const std::string &output_key, JsonObject &output_value) {
+    if (pool != nullptr) {
+      output_value.Intern(*pool);
+    }
+    good = writer.Add(output_key, output_value) && good;
+  };
+  auto change = delta.begin();
+  while (size > 0 || loaded || change != delta.end()) {
+    if (cancel || !good) {
+      return std::string::npos;
+    }
+    if (!loaded && size > 0) {
+      if (!next(key, value)) {
+        throw std::runtime_error("database: could not read snapshot");
+      }
+      loaded = true;
+      size--;
+    }
+    if (change != delta.end() && (!loaded || change->first < key)) {
+      if (change->second.first == kStoragePatch) {
+        throw std::runtime_error("journal: patch non-existent key " +
+                                 change->first);
+      }
+      if (change->second.first == kStorageUpdate) {
+        emit(change->first, change->second.second.front());
+      }
+      change->second.second.clear();
+      change++;
+    } else if (change != delta.end() && change->first == key) {
+      if (change->second.first == kStorageUpdate) {
+        emit(change->first, change->second.second.front());
+      } else if (change->second.first == kStoragePatch) {
+        for (JsonObject &patch : change->second.second) {
+          Patcher<JsonObject>::Patch(value, patch);
+        }
+        emit(key, value);
+      }
+      change->second.second.clear();
+      loaded = false;
+      change++;
+    } else {
+      emit(key, value);
+      loaded = false;
+    }
+  }
+  if (!good) {
+    return std::string::npos;
+  }
+  return writer.Close();
+}
+
 }  // namespace db
 
 ApiService::ApiService() {}
 
 ApiService::~ApiService() {}
 
-DocumentDatabase::DocumentDatabase(const std::string &filepath)
+DocumentDatabase::DocumentDatabase(const std::string &filepath,
+                                   uint64_t cache_capacity, bool string_pool,
+                                   DatabaseDurability durability,
+                                   DatabaseCheckpoint checkpoint,
+                                   bool lazy_loading,
+                                   CompressionCodec compression)
     : filepath_(filepath),
       filepath_journal_(filepath + kServiceSuffixJournal),
       filepath_closed_(filepath + kServiceSuffixJournal + kServiceSuffixClosed),
       filepath_snapshot_(filepath + kServiceSuffixSnapshot),
       filepath_corrupted_(filepath_ + kServiceSuffixCorrupted),
+      durability_(durability),
+      checkpoint_(checkpoint),
+      checkpoint_process_(-1),
+      lazy_loading_(lazy_loading),
+      compression_(compression),
+      cache_(cache_capacity),
       rollover_in_progress_(false),
-      rollover_cancel_(false) {}
+      rollover_cancel_(false) {
+  if (string_pool) {
+    string_pool_ = std::make_unique<JsonStringPool>();
+  }
+}
 
 DocumentDatabase::~DocumentDatabase() {}
 
 void DocumentDatabase::Initialize() {
-  size_t bytes;
   random_.Seed((uint64_t)time(nullptr));
+  if (!lazy_loading_ || !LoadLazily()) {
+    LoadEagerly();
+  }
+  OpenJournal();
+  rollover_in_progress_ = false;
+  rollover_cancel_ = false;
+  double usage = DatabaseMemory::Consumption(database_) / 1024.0 / 1024.0;
+  LOG_INFO("memory usage: " + std::to_string(usage) + " megabytes");
+  if (string_pool_) {
+    LOG_INFO("string pool: " + std::to_string(string_pool_->Size()) +
+             " strings, " +
+             std::to_string(string_pool_->Memory() / 1024.0 / 1024.0) +
+             " megabytes");
+  }
+  LOG_INFO("cache capacity: " +
+           std::to_string(cache_.GetCapacity() / 1024.0 / 1024.0) +
+           " megabytes");
+}
+
+void DocumentDatabase::LoadEagerly() {
+  size_t bytes;
   if (FileExists(filepath_)) {
     bytes = db::Deserialize(filepath_, database_);
     if (bytes == std::string::npos) {
@@ -69,7 +244,7 @@ void DocumentDatabase::Initialize() {
   bool unlink_journal = false;
   if (FileExists(filepath_closed_)) {
     try {
-      DatabaseJournal::Replay(filepath_closed_, database_);
+      db::Replay(filepath_closed_, database_);
     } catch (std::runtime_error &) {
       rename(filepath_closed_.c_str(), filepath_corrupted_.c_str());
       throw std::runtime_error("error during closed journal replay");
@@ -79,7 +254,7 @@ void DocumentDatabase::Initialize() {
   }
   if (FileExists(filepath_journal_)) {
     try {
-      DatabaseJournal::Replay(filepath_journal_, database_);
+      db::Replay(filepath_journal_, database_);
     } catch (std::runtime_error &) {
       rename(filepath_journal_.c_str(), filepath_corrupted_.c_str());
       throw std::runtime_error("error during journal replay");
@@ -87,9 +262,13 @@ void DocumentDatabase::Initialize() {
     rollover_necessary = true;
     unlink_journal = true;
   }
+  if (string_pool_) {
+    database_.Apply(
+        [this](JsonObject &value) { value.Intern(*string_pool_); });
+  }
   if (rollover_necessary) {
     LOG_INFO("database journal rollover");
-    bytes = db::Serialize(filepath_snapshot_, database_);
+    bytes = db::Serialize(filepath_snapshot_, database_, compression_);
     if (bytes == std::string::npos) {
       remove(filepath_snapshot_.c_str());
       throw std::runtime_error("error when writing snapshot to disk");
@@ -103,27 +282,102 @@ void DocumentDatabase::Initialize() {
   if (unlink_journal) {
     remove(filepath_journal_.c_str());
   }
-  stream_journal_.open(filepath_journal_, std::fstream::binary);
-  rollover_in_progress_ = false;
-  rollover_cancel_ = false;
-  double usage = DatabaseMemory::Consumption(database_) / 1024.0 / 1024.0;
-  LOG_INFO("memory usage: " + std::to_string(usage) + " megabytes");
 }
 
-void DocumentDatabase::Tick() { Rollover(); }
+bool DocumentDatabase::LoadLazily() {
+  if (!FileExists(filepath_) || FileExists(filepath_closed_)) {
+    return false;
+  }
+  std::function<void(JsonObject &)> prepare;
+  if (string_pool_) {
+    prepare = [this](JsonObject &value) { value.Intern(*string_pool_); };
+  }
+  if (!loader_.Open(filepath_, database_, prepare)) {
+    return false;
+  }
+  LOG_INFO("lazy loading: " + std::to_string(loader_.Pages()) +
+           " snapshot pages");
+  if (FileExists(filepath_journal_)) {
+    DatabaseDelta delta;
+    try {
+      DatabaseJournal::Collect(filepath_journal_, delta);
+      for (auto &change : delta) {
+        loader_.Fault(change.first);
+      }
+      db::Replay(filepath_journal_, database_);
+    } catch (std::runtime_error &) {
+      loader_.Close();
+      rename(filepath_journal_.c_str(), filepath_corrupted_.c_str());
+      throw std::runtime_error("error during journal replay");
+    }
+    rename(filepath_journal_.c_str(), filepath_closed_.c_str());
+  }
+  return true;
+}
+
+void DocumentDatabase::Tick() {
+  if (loader_.IsLoading()) {
+    loader_.Install();
+    if (!loader_.IsLoading()) {
+      LOG_INFO("lazy loading completed");
+    }
+  }
+  if (string_pool_) {
+    string_pool_->Purge();
+  }
+  if (durability_ == DURABILITY_NONE) {
+    journal_.Submit();
+  }
+  if (journal_.GetBatches() > 0) {
+    LOG_INFO("journal: " + std::to_string(journal_.GetQueueDepth()) +
+             " bytes queued, " + std::to_string(journal_.GetBatches()) +
+             " batches, " + std::to_string(journal_.GetLatencyAverage()) +
+             " us average latency, " +
+             std::to_string(journal_.GetLatencyMaximum()) +
+             " us maximum latency");
+  }
+  Rollover();
+}
+
+uint64_t DocumentDatabase::Commit() {
+  if (durability_ != DURABILITY_NONE) {
+    return journal_.Submit();
+  }
+  if (journal_.GetBuffered() >= kJournalBufferLimit) {
+    journal_.Submit();
+  }
+  return 0;
+}
+
+uint64_t DocumentDatabase::GetCommitted() const {
+  return journal_.GetCommitted();
+}
+
+int DocumentDatabase::GetNotifier() const { return journal_.GetNotifier(); }
 
 void DocumentDatabase::Shutdown() {
   if (rollover_worker_.joinable()) {
     rollover_cancel_ = true;
     rollover_worker_.join();
   }
-  stream_journal_.close();
+  if (checkpoint_process_ != -1) {
+    kill(checkpoint_process_, SIGKILL);
+    ReapCheckpoint(true);
+  }
+  loader_.Close();
+  CloseJournal();
+}
+
+void DocumentDatabase::OpenJournal() {
+  journal_.Open(filepath_journal_, durability_, compression_);
 }
 
+void DocumentDatabase::CloseJournal() { journal_.Close(); }
+
 void DocumentDatabase::RotateJournal() {
-  stream_journal_.close();
+  CloseJournal();
   rename(filepath_journal_.c_str(), filepath_closed_.c_str());
-  stream_journal_.open(filepath_journal_, std::fstream::binary);
+  OpenJournal();
 }
 
 void DocumentDatabase::Rollover() {
@@ -134,42 +388,43 @@ void DocumentDatabase::Rollover() {
     rollover_worker_.join();
     LOG_INFO("deferred journal rollover completed");
   }
+  if (checkpoint_process_ != -1 && !ReapCheckpoint(false)) {
+    return;
+  }
+  bool rotate = false;
   if (FileExists(filepath_)) {
     if (FileExists(filepath_journal_)) {
       if (FileSize(filepath_journal_) > FileSize(filepath_)) {
-        RotateJournal();
+        rotate = true;
       }
     }
   } else {
     if (FileExists(filepath_journal_)) {
       if (FileSize(filepath_journal_) > 16 * 1024 * 1024) {
-        RotateJournal();
+        rotate = true;
       }
     }
   }
+  if (rotate && checkpoint_ == CHECKPOINT_FORK &&
+      !FileExists(filepath_closed_)) {
+    RotateJournal();
+    loader_.Finish();
+    ForkCheckpoint();
+    return;
+  }
+  if (rotate) {
+    RotateJournal();
+  }
   if (FileExists(filepath_closed_)) {
     rollover_in_progress_ = true;
     LOG_INFO("defer journal rollover");
     rollover_worker_ = std::thread([this] {
       size_t bytes;
-      Database database;
-      if (FileExists(filepath_)) {
-        LOG_INFO("journal rollover: load snapshot");
-        bytes = db::Deserialize(filepath_, database, rollover_cancel_);
-        if (bytes == std::string::npos) {
-          if (rollover_cancel_) {
-            LOG_INFO("rollover cancel");
-          } else {
-            LOG_INFO("rollover failed: snapshot corrupted");
-            rename(filepath_.c_str(), filepath_corrupted_.c_str());
-          }
-          rollover_in_progress_ = false;
-          return;
-        }
-      }
-      LOG_INFO("journal rollover: replay closed journal");
+      JsonStringPool pool;
+      DatabaseDelta delta;
+      LOG_INFO("journal rollover: collect closed journal");
       try {
-        DatabaseJournal::Replay(filepath_closed_, database, rollover_cancel_);
+        DatabaseJournal::Collect(filepath_closed_, delta, rollover_cancel_);
       } catch (std::runtime_error &) {
         LOG_INFO("rollover failed: closed journal corrupted");
         rename(filepath_closed_.c_str(), filepath_corrupted_.c_str());
@@ -181,8 +436,25 @@ void DocumentDatabase::Rollover() {
         rollover_in_progress_ = false;
         return;
       }
-      LOG_INFO("journal rollover: write snapshot");
-      bytes = db::Serialize(filepath_snapshot_, database, rollover_cancel_);
+      LOG_INFO("journal rollover: merge " + std::to_string(delta.size()) +
+               " changes into snapshot");
+      try {
+        bytes = db::Merge(filepath_, filepath_snapshot_, delta,
+                          string_pool_ ? &pool : nullptr, compression_,
+                          rollover_cancel_);
+      } catch (std::runtime_error &e) {
+        LOG_INFO(std::string(e.what()));
+        remove(filepath_snapshot_.c_str());
+        if (FileExists(filepath_)) {
+          LOG_INFO("rollover failed: snapshot corrupted");
+          rename(filepath_.c_str(), filepath_corrupted_.c_str());
+        } else {
+          LOG_INFO("rollover failed: closed journal corrupted");
+          rename(filepath_closed_.c_str(), filepath_corrupted_.c_str());
+        }
+        rollover_in_progress_ = false;
+        return;
+      }
       if (bytes == std::string::npos) {
         if (rollover_cancel_) {
           LOG_INFO("rollover cancel");
@@ -200,11 +472,53 @@ void DocumentDatabase::Rollover() {
   }
 }
 
+void DocumentDatabase::ForkCheckpoint() {
+  LOG_INFO("checkpoint: fork snapshot process");
+  pid_t process = fork();
+  if (process == -1) {
+    LOG_INFO("checkpoint failed: could not fork");
+    return;
+  }
+  if (process == 0) {
+    try {
+      size_t bytes =
+          db::Serialize(filepath_snapshot_, database_, compression_);
+      _exit(bytes == std::string::npos ? EXIT_FAILURE : EXIT_SUCCESS);
+    } catch (...) {
+      _exit(EXIT_FAILURE);
+    }
+  }
+  checkpoint_process_ = process;
+}
+
+bool DocumentDatabase::ReapCheckpoint(bool block) {
+  int status;
+  pid_t process = waitpid(checkpoint_process_, &status, block ? 0 : WNOHANG);
+  if (process == 0) {
+    return false;
+  }
+  checkpoint_process_ = -1;
+  if (process != -1 && WIFEXITED(status) &&
+      WEXITSTATUS(status) == EXIT_SUCCESS) {
+    rename(filepath_snapshot_.c_str(), filepath_.c_str());
+    remove(filepath_closed_.c_str());
+    LOG_INFO("checkpoint completed");
+  } else {
+    LOG_INFO("checkpoint failed: remove snapshot");
+    remove(filepath_snapshot_.c_str());
+  }
+  return true;
+}
+
 JsonArray DocumentDatabase::Insert(const JsonArray &values) {
   JsonArray result;
   std::string key;
   bool unique;
   JsonObject value;
+  bool batch = values.Size() > 1;
+  if (batch) {
+    DatabaseJournal::Mark(journal_.GetStream(), kStorageBegin);
+  }
   for (size_t i = 0; i < values.Size(); i++) {
     if (!values.IsObject(i)) {
       result.PutNull();
@@ -213,13 +527,17 @@ JsonArray DocumentDatabase::Insert(const JsonArray &values) {
     unique = false;
     while (!unique) {
       key = random_.Uuid();
+      loader_.Fault(key);
       if (!database_.Contains(key)) {
         unique = true;
       }
     }
     result.PutString(key);
     value = values.GetObject(i);
-    DatabaseJournal::Append(stream_journal_, kStorageInsert, key, value);
+    if (string_pool_) {
+      value.Intern(*string_pool_);
+    }
+    DatabaseJournal::Append(journal_.GetStream(), kStorageInsert, key, value);
     try {
       database_.Insert(key, value);
     } catch (std::exception &e) {
@@ -228,17 +546,25 @@ JsonArray DocumentDatabase::Insert(const JsonArray &values) {
       abort();
     }
   }
+  if (batch) {
+    DatabaseJournal::Mark(journal_.GetStream(), kStorageCommit);
+  }
   return result;
 }
 
 JsonObject DocumentDatabase::Update(const JsonObject &values) {
   JsonObject result;
   JsonObject value;
+  bool batch = values.Size() > 1;
+  if (batch) {
+    DatabaseJournal::Mark(journal_.GetStream(), kStorageBegin);
+  }
   for (std::string &key : values.Keys()) {
     if (!values.IsObject(key)) {
       result.PutNull(key);
       continue;
     }
+    loader_.Fault(key);
     auto iterator = database_.Find(key);
     if (iterator == database_.End()) {
       result.PutNull(key);
@@ -246,7 +572,14 @@ JsonObject DocumentDatabase::Update(const JsonObject &values) {
     }
     result.PutObject(key, iterator.GetValue());
     value = values.GetObject(key);
-    DatabaseJournal::Append(stream_journal_, kStorageUpdate, key, value);
+    if (string_pool_) {
+      value.Intern(*string_pool_);
+    }
+    if (value == iterator.GetValue()) {
+      continue;
+    }
+    DatabaseJournal::Append(journal_.GetStream(), kStorageUpdate, key, value);
+    cache_.Erase(key);
     try {
       database_.Update(iterator, value);
     } catch (std::exception &e) {
@@ -255,27 +588,73 @@ JsonObject DocumentDatabase::Update(const JsonObject &values) {
       abort();
     }
   }
+  if (batch) {
+    DatabaseJournal::Mark(journal_.GetStream(), kStorageCommit);
+  }
+  return result;
+}
+
+JsonObject DocumentDatabase::Patch(const JsonObject &patches) {
+  JsonObject result;
+  JsonObject patch;
+  bool batch = patches.Size() > 1;
+  if (batch) {
+    DatabaseJournal::Mark(journal_.GetStream(), kStorageBegin);
+  }
+  for (std::string &key : patches.Keys()) {
+    if (!patches.IsObject(key)) {
+      result.PutNull(key);
+      continue;
+    }
+    loader_.Fault(key);
+    auto iterator = database_.Find(key);
+    if (iterator == database_.End()) {
+      result.PutNull(key);
+      continue;
+    }
+    patch = patches.GetObject(key);
+    if (string_pool_) {
+      patch.Intern(*string_pool_);
+    }
+    DatabaseJournal::Append(journal_.GetStream(), kStoragePatch, key, patch);
+    cache_.Erase(key);
+    try {
+      database_.Patch(iterator, patch);
+    } catch (std::exception &e) {
+      Trace::GetInstance()->Print();
+      LOG_INFO(std::string(e.what()));
+      abort();
+    }
+    result.PutObject(key, iterator.GetValue());
+  }
+  if (batch) {
+    DatabaseJournal::Mark(journal_.GetStream(), kStorageCommit);
+  }
   return result;
 }
 
 JsonArray DocumentDatabase::Erase(const JsonArray &keys) {
   JsonArray result;
   std::string key;
-  JsonObject value;
+  bool batch = keys.Size() > 1;
+  if (batch) {
+    DatabaseJournal::Mark(journal_.GetStream(), kStorageBegin);
+  }
   for (size_t i = 0; i < keys.Size(); i++) {
     if (!keys.IsString(i)) {
       result.PutNull();
       continue;
     }
     key = keys.GetString(i);
+    loader_.Fault(key);
     auto iterator = database_.Find(key);
     if (iterator == database_.End()) {
       result.PutNull();
       continue;
     }
     result.PutString(key);
-    value = iterator.GetValue();
-    DatabaseJournal::Append(stream_journal_, kStorageErase, key, value);
+    DatabaseJournal::Append(journal_.GetStream(), kStorageEraseKey, key);
+    cache_.Erase(key);
     try {
       database_.Erase(iterator);
     } catch (std::exception &e) {
@@ -284,23 +663,41 @@ JsonArray DocumentDatabase::Erase(const JsonArray &keys) {
       abort();
     }
   }
+  if (batch) {
+    DatabaseJournal::Mark(journal_.GetStream(), kStorageCommit);
+  }
   return result;
 }
 
-JsonArray DocumentDatabase::Find(const JsonArray &keys) const {
-  JsonArray result;
+std::string DocumentDatabase::FindString(const JsonArray &keys) {
+  std::string result = kStringSquareBracketOpen;
+  std::string key;
+  std::string text;
+  const std::string *cached;
   for (size_t i = 0; i < keys.Size(); i++) {
+    if (i > 0) {
+      result += kStringComma;
+    }
     if (!keys.IsString(i)) {
-      result.PutNull();
+      result += kJsonNull;
+      continue;
+    }
+    key = keys.GetString(i);
+    if ((cached = cache_.Find(key)) != nullptr) {
+      result += *cached;
       continue;
     }
-    auto iterator = database_.Find(keys.GetString(i));
+    loader_.Fault(key);
+    auto iterator = database_.Find(key);
     if (iterator == database_.End()) {
-      result.PutNull();
+      result += kJsonNull;
       continue;
     }
-    result.PutObject(iterator.GetValue());
+    text = iterator.GetValue().String();
+    result += text;
+    cache_.Insert(key, text);
   }
+  result += kStringSquareBracketClose;
   return result;
 }
 
@@ -312,6 +709,12 @@ void UserPool::Initialize() { users_.Parse(FileToString(filepath_)); }
 
 void UserPool::Tick() {}
 
+uint64_t UserPool::Commit() { return 0; }
+
+uint64_t UserPool::GetCommitted() const { return 0; }
+
+int UserPool::GetNotifier() const { return -1; }
+
 void UserPool::Shutdown() {}
 
 bool UserPool::AccessPermitted(const std::string &user,
@@ -337,7 +337,7 @@ TcpSocket *TcpSocket::Accept() {
   return client;
 }
 
-IoStatusCode TcpSocket::Receive(std::string &payload) {
+IoStatusCode TcpSocket::Receive(std::string &payload, long limit) {
   if (IsBlocking()) {
     return SOCKET_FLAGS;
   }
@@ -349,8 +349,12 @@ IoStatusCode TcpSocket::Receive(std::string &payload) {
   }
   ssize_t bytes;
   ssize_t length;
+  long received = 0;
   char buffer[kTcpReceiveBufferSize];
   for (;;) {
+    if (received >= limit) {
+      return SUCCESS;
+    }
     length = std::min(kTcpReceiveBufferSize,
                       kTcpMaximumPayloadSize - (long)payload.size());
     bytes = recv(descriptor_, buffer, length, 0);
@@ -367,6 +371,7 @@ IoStatusCode TcpSocket::Receive(std::string &payload) {
         return DISCONNECT;
       default:
         payload.insert(payload.end(), &buffer[0], &buffer[bytes]);
+        received += bytes;
         if (payload.size() >= kTcpMaximumPayloadSize) {
           return OVERFLOW;
         }
@@ -452,9 +457,13 @@ void TcpReader::ReadUntil(size_t length) {
   }
 }
 
-bool TcpReader::HasErrors() const { return status_ != BLOCKED; }
+bool TcpReader::HasErrors() const {
+  return status_ != SUCCESS && status_ != BLOCKED;
+}
 
-void TcpReader::ReadSome() { status_ = socket_->Receive(buffer_); }
+void TcpReader::ReadSome() {
+  status_ = socket_->Receive(buffer_, kTcpReceiveChunkSize);
+}
 
 void TcpReader::SyncRead() {
   while (true) {
@@ -526,6 +535,13 @@ std::string TcpReader::Tok(size_t length) {
   return result;
 }
 
+void TcpReader::Discard() {
+  buffer_.erase(0, base_);
+  peak_ -= base_;
+  next_base_ -= base_;
+  base_ = 0;
+}
+
 TcpWriter::TcpWriter(TcpSocket *socket)
     : buffer_(kStringEmpty), socket_(socket), status_(NONE) {}
 
@@ -205,6 +205,39 @@ int main(int argc, char **argv) {
                    std::to_string(clock.Time() / count) + kStringSpace +
                    "microseconds" + kStringSpace + "per update");
 
+          clock.Start();
+          for (size_t i = 0; i < order; i++) {
+            auto it = mirror.begin();
+            std::advance(it, random.UniformInteger() % mirror.size());
+            std::string key = it->first;
+            JsonObject nested;
+            nested.PutInteger(kJsonKeySet[7], random.UniformInteger() % 1048576);
+            nested.PutNull(kJsonKeySet[9]);
+            JsonObject patch;
+            patch.PutInteger(kJsonKeySet[2], random.UniformInteger() % 1048576);
+            patch.PutNull(kJsonKeySet[4]);
+            patch.PutObject(kJsonKeySet[10], nested);
+            JsonObject patches;
+            patches.PutObject(key, patch);
+            JsonObject result = client.Patch(patches);
+            if (!result.Has(key) || result.IsNull(key)) {
+              throw std::runtime_error("patch non-existent key");
+            }
+            if (!result.IsObject(key)) {
+              throw std::runtime_error("return value is non-object");
+            }
+            it->second.Patch(patch);
+            if (it->second.String() != result.GetObject(key).String()) {
+              throw std::runtime_error("return value differs from mirror");
+            }
+          }
+          clock.Stop();
+          LOG_INFO("thread" + kStringSpace + std::to_string(index) +
+                   kStringSpace + "cycle" + kStringSpace + std::to_string(i) +
+                   kStringSpace + "took" + kStringSpace +
+                   std::to_string(clock.Time() / count) + kStringSpace +
+                   "microseconds" + kStringSpace + "per patch");
+
           clock.Start();
           for (size_t i = 0; i < order; i++) {
             auto it = mirror.begin();